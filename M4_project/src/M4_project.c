@@ -17,6 +17,8 @@
 #include "drv/nl_kbs.h"
 
 #include "usb/nl_usb_midi.h"
+#include "usb/nl_usb_core.h"
+#include "usb/nl_usb_midi_bench.h"
 #include "cpu/nl_cpu.h"
 #include "ipc/emphase_ipc.h"
 
@@ -28,12 +30,17 @@
 #include "tcd/nl_tcd_poly.h"
 #include "tcd/nl_tcd_expon.h"
 #include "tcd/nl_tcd_param_work.h"
+#include "tcd/nl_tcd_preset_cache.h"
 #include "tcd/nl_tcd_msg.h"
 #include "sup/nl_sup.h"
 #include "heartbeat/nl_heartbeat.h"
 
 volatile uint8_t  waitForFirstSysTick = 1;
 
+#ifdef EXPON_BENCHMARK
+EXPON_BENCH_RESULT_T exponBenchResult;		// read with the debugger
+#endif
+
 
 #if 0
 void BbbCallback(uint16_t type, uint16_t length, uint16_t* data)
@@ -136,13 +143,18 @@ void Init(void)
 #endif
 
     /* USB */
+    HBT_Init();
+    MSG_Init();								// wire format requests of the ePC
+#ifdef USB_MIDI_BENCHMARK
+    USB_MIDI_BENCH_Init();					// loopback and stream test with tools/usb_midi_bench (takes over the SysEx messages)
+#endif
     USB_MIDI_Init();
     USB_MIDI_Config(HBT_MidiReceive);
 
 	volatile uint32_t timeOut = 0x0FFFFF;
 
 	do  {
-		USB_MIDI_Poll();
+		USB_MIDI_Poll();							// the enumeration runs in the USB0 interrupt, this only drains the deferred work
 		timeOut--;
 	}	while ((!USB_MIDI_IsConfigured()) && (timeOut > 0));
 
@@ -150,19 +162,30 @@ void Init(void)
 //		DBG_Led_Usb_Off();
 
     /* lpc bbb communication */
-	SPI_BB_Init(BB_MSG_ReceiveCallback);
+	SPI_BB_Init();
 
 	/* TCD */
-	EXPON_Init();
+#ifdef EXPON_BENCHMARK
+	EXPON_Benchmark(&exponBenchResult);
+#endif
 	VALLOC_Init(NUM_VOICES);
 	POLY_Init();
 	PARAM_WORK_Init();
+	PRESET_CACHE_Init();
 
 	/* scheduler */
     COOS_Init();
 
     COOS_Task_Add(NL_GPDMA_Poll,    10,    1);	// every 125 us, for all the DMA transfers (SPI devices)
-    COOS_Task_Add(USB_MIDI_Poll,    15,    1);	// every 125 us, same time grid as in USB 2.0
+    COOS_Task_Add(USB_MIDI_Poll,   15,    1);	// every 125 us, the class callbacks posted by the USB0 interrupt (received MIDI, IN completions), with USB_POLLING also the USB0 handler
+
+    COOS_Task_Add(BB_MSG_ProcessCommands, 16, 1);	// every 125 us, applying the parameter, preset and setting messages from the BBB
+
+#ifdef USB_MIDI_BENCHMARK
+    COOS_Task_Add(USB_MIDI_BENCH_Process, 17, 8);	// every 1 ms, stream packets and report of the USB-MIDI test
+#endif
+
+    COOS_Task_Add(PARAM_WORK_Process, 18,  1);	// every 125 us, sending the parameters changed by MCs and play controls
 
     COOS_Task_Add(VALLOC_Process,   20,    1);	// every 125 us, reading and applying keybed events
 
@@ -170,7 +193,7 @@ void Init(void)
 
     COOS_Task_Add(ADC_WORK_Init, 	60,    0);	// preparing the ADC processing (will be executed after the M0 has been initialized)
     COOS_Task_Add(ADC_WORK_Process, 70,   100);	// every 12.5 ms, reading ADC values and applying changes
-    COOS_Task_Add(ADC_WORK_SendBBMessages, 85,   800);	// every 100 ms, sending the results of the ADC processing to the BBB
+    COOS_Task_Add(ADC_WORK_SendBBMessages, 85,    80);	// every 10 ms, sending the results of the ADC processing to the BBB (every 20 ms while moving, 100 ms otherwise)
 
     COOS_Task_Add(MSG_CheckUSB,		105, 1600);	// every 200 ms, checking if the USB connection to the ePC or the ePC is still working
     COOS_Task_Add(DBG_Process,      95, 4800);	// every 600 ms
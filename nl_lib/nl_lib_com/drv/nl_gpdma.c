@@ -9,6 +9,7 @@
 
 static TransferCallback NL_GPDMA_Callbacks[8];
 static uint8_t channels = 0;
+static uint8_t linked = 0;				// channels started with a linked list, the controller ends them
 static uint8_t initialized = 0;
 
 /**
@@ -77,6 +78,9 @@ void NL_GPDMA_Init(uint8_t ch)
  * 				the transfer, this function needs to cleanup that channel first.
  * 				This means that this function should be called after
  * 				the desired transfer has finished.
+ * 				A block of a linked list with GPDMA_CCONTROL_I calls the
+ * 				callback as well; a linked list is not disabled here, the
+ * 				controller ends it after its last block.
 *******************************************************************************/
 void NL_GPDMA_Poll(void)
 {
@@ -93,13 +97,12 @@ void NL_GPDMA_Poll(void)
 			if (LPC_GPDMA->INTTCSTAT & GPDMA_DMACIntTCStat_Ch(tmp)) {
 				// Clear terminate counter Interrupt pending
 				LPC_GPDMA->INTTCCLEAR = GPDMA_DMACIntTCClear_Ch(tmp);
-				/* Disable the channel */
+				/* Disable the channel of a single block. A linked list may
+				 * still be running (CLLI is 0 during its last block), the
+				 * controller disables the channel after the last one. */
 				pDMAch = (LPC_GPDMACH_TypeDef *) pGPDMAC[tmp];
-#if 0
-			if(pDMAch->CLLI)
-				continue;
-#endif
-				pDMAch->CConfig &= ~GPDMA_DMACCxConfig_E;
+				if((linked & (1<<tmp)) == 0)
+					pDMAch->CConfig &= ~GPDMA_DMACCxConfig_E;
 
 				if(NL_GPDMA_Callbacks[tmp])
 					NL_GPDMA_Callbacks[tmp](SUCCESS);
@@ -120,6 +123,24 @@ void NL_GPDMA_Poll(void)
 }
 
 Status NL_GPDMA_SetupChannel(NL_GPDMA_ChDesc* desc, TransferCallback callback)
+{
+	return NL_GPDMA_SetupChannelLLI(desc, 0, callback);
+}
+
+/******************************************************************************/
+/** @brief    	Starts a transfer of several blocks: the first one is described
+ * 				by desc, the following ones by the linked list. A list that
+ * 				points back to its start runs until the channel is stopped.
+ * 				Blocks with the terminal count interrupt (GPDMA_CCONTROL_I)
+ * 				call the callback from NL_GPDMA_Poll(); if it comes late,
+ * 				several blocks may have finished.
+ * @param[in]	desc	channel, peripherals and the first block
+ * @param[in]	next	the second block, 0: single block
+ * @param[in]	callback	called by NL_GPDMA_Poll() at the end of blocks
+ * 							with GPDMA_CCONTROL_I or on errors
+ * @return		SUCCESS; ERROR - channel not available or busy
+*******************************************************************************/
+Status NL_GPDMA_SetupChannelLLI(NL_GPDMA_ChDesc* desc, const NL_GPDMA_LLI* next, TransferCallback callback)
 {
 	LPC_GPDMACH_TypeDef *pDMAch;
 	uint8_t SrcPeripheral=0, DestPeripheral=0;
@@ -147,7 +168,11 @@ Status NL_GPDMA_SetupChannel(NL_GPDMA_ChDesc* desc, TransferCallback callback)
 	pDMAch->CConfig = 0x00;
 
 	/* Assign Linker List Item value */
-	pDMAch->CLLI = 0;
+	pDMAch->CLLI = (uint32_t) next;
+	if(next)
+		linked |= (1<<chan);
+	else
+		linked &= ~(1<<chan);
 
 #if 0
 	if(chan == GPDMA_UART_0_TX_CHANNEL || chan == GPDMA_UART_2_TX_CHANNEL ||
@@ -178,6 +203,8 @@ Status NL_GPDMA_SetupChannel(NL_GPDMA_ChDesc* desc, TransferCallback callback)
 	}
 	else return ERROR;
 
+	NL_GPDMA_Callbacks[chan] = callback;
+
 	/* Enable DMA channels, little endian */
 	LPC_GPDMA->CONFIG = GPDMA_DMACConfig_E;
 	while (!(LPC_GPDMA->CONFIG & GPDMA_DMACConfig_E));
@@ -189,8 +216,6 @@ Status NL_GPDMA_SetupChannel(NL_GPDMA_ChDesc* desc, TransferCallback callback)
 		| GPDMA_DMACCxConfig_SrcPeripheral(SrcPeripheral) \
 		| GPDMA_DMACCxConfig_DestPeripheral(DestPeripheral);
 
-	NL_GPDMA_Callbacks[chan] = callback;
-
 	return SUCCESS;
 }
 
@@ -202,3 +227,83 @@ uint32_t NL_GPDMA_ChannelBusy(uint8_t ch)
 	else
 		return 0;
 }
+
+/******************************************************************************/
+/** @brief    	Returns the number of transfers (in source width) which are
+ * 				not done yet, 0 if the channel is not enabled
+*******************************************************************************/
+uint32_t NL_GPDMA_Remaining(uint8_t ch)
+{
+	LPC_GPDMACH_TypeDef *pDMAch;
+
+	if(ch >= 8)
+		return 0;
+
+	pDMAch = (LPC_GPDMACH_TypeDef *) pGPDMAC[ch];
+
+	if((pDMAch->CConfig & GPDMA_DMACCxConfig_E) == 0)
+		return 0;
+
+	return pDMAch->CControl & 0xFFF;
+}
+
+/******************************************************************************/
+/** @brief    	Returns the current source address of a channel, the position
+ * 				of a transfer from memory to a peripheral
+*******************************************************************************/
+uint32_t NL_GPDMA_SrcAddr(uint8_t ch)
+{
+	if(ch >= 8)
+		return 0;
+
+	return pGPDMAC[ch]->CSrcAddr;
+}
+
+/******************************************************************************/
+/** @brief    	Returns the current destination address of a channel, the
+ * 				position of a transfer from a peripheral to memory
+*******************************************************************************/
+uint32_t NL_GPDMA_DstAddr(uint8_t ch)
+{
+	if(ch >= 8)
+		return 0;
+
+	return pGPDMAC[ch]->CDestAddr;
+}
+
+/******************************************************************************/
+/** @brief    	Stops a transfer before its end. The channel is halted until
+ * 				its FIFO is empty and then disabled, the callback is not called,
+ * 				also not for a transfer which has just finished and is not
+ * 				polled yet.
+ * @param[in]	ch	DMA channel
+ * @return		number of transfers (in source width) that were not done
+*******************************************************************************/
+uint32_t NL_GPDMA_StopChannel(uint8_t ch)
+{
+	LPC_GPDMACH_TypeDef *pDMAch;
+	uint32_t remaining;
+
+	if(ch >= 8)
+		return 0;
+
+	pDMAch = (LPC_GPDMACH_TypeDef *) pGPDMAC[ch];
+
+	NL_GPDMA_Callbacks[ch] = NULL;
+
+	if((pDMAch->CConfig & GPDMA_DMACCxConfig_E) == 0)
+		remaining = 0;											// already finished
+	else {
+		pDMAch->CConfig |= GPDMA_DMACCxConfig_H;				// ignoring further requests
+		while(pDMAch->CConfig & GPDMA_DMACCxConfig_A);			// data left in the channel FIFO
+
+		remaining = pDMAch->CControl & 0xFFF;
+
+		pDMAch->CConfig &= ~GPDMA_DMACCxConfig_E;
+	}
+
+	LPC_GPDMA->INTTCCLEAR = GPDMA_DMACIntTCClear_Ch(ch);
+	LPC_GPDMA->INTERRCLR = GPDMA_DMACIntErrClr_Ch(ch);
+
+	return remaining;
+}
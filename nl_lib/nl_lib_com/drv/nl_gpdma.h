@@ -64,9 +64,23 @@ typedef struct {
 	uint32_t	ccontrol;
 } NL_GPDMA_ChDesc;
 
+/** linked list item, loaded by the channel after the end of the previous
+ *  block (word aligned, the GPDMA reads it from memory) */
+typedef struct {
+	uint32_t	srcaddr;
+	uint32_t	dstaddr;
+	uint32_t	next;			/* address of the next item, 0: last block */
+	uint32_t	ccontrol;		/* including the length */
+} NL_GPDMA_LLI;
+
 void NL_GPDMA_Init(uint8_t ch);
 void NL_GPDMA_Poll(void);
 Status NL_GPDMA_SetupChannel(NL_GPDMA_ChDesc* desc, TransferCallback callback);
+Status NL_GPDMA_SetupChannelLLI(NL_GPDMA_ChDesc* desc, const NL_GPDMA_LLI* next, TransferCallback callback);
+uint32_t NL_GPDMA_SrcAddr(uint8_t ch);
+uint32_t NL_GPDMA_DstAddr(uint8_t ch);
 uint32_t NL_GPDMA_ChannelBusy(uint8_t ch);
+uint32_t NL_GPDMA_Remaining(uint8_t ch);
+uint32_t NL_GPDMA_StopChannel(uint8_t ch);
 
 #endif
@@ -10,6 +10,17 @@
 
 //#define I2S_USE_BASE_AUDIO_CLK
 
+typedef struct {
+	NL_GPDMA_LLI lli[I2S_DMA_MAX_PERIODS];		/* circular list, one item per period */
+	uint32_t* buff;
+	uint32_t periodLen;
+	uint32_t len;								/* 0: not running */
+	uint32_t next;								/* next period for the callback */
+	I2S_DMA_PeriodCallback callback;
+} I2S_DMA_STREAM_T;
+
+static I2S_DMA_STREAM_T streams[2];
+
 /*********************************************************************
  * @brief		Calculate dividers and bitrate for I2S registers
  * @param[in]	bits	transfer word width
@@ -142,6 +153,56 @@ void I2S_DMA_Init(LPC_I2Sn_Type *I2Sx, uint8_t bits, uint32_t freq, uint8_t mode
 	I2Sx->DAI &= ~I2S_DA_RESET;
 }
 
+/**********************************************************************
+ * @brief		Channel, peripheral and control of a TX transfer
+ * @param[in]	I2Sx	LPC_I2S0 or LPC_I2S1
+ * @param[out]	desc	descriptor without buffer and length
+ * @return		SUCCESS; ERROR - unknown peripheral
+ **********************************************************************/
+static Status I2S_DMA_TxDesc(LPC_I2Sn_Type *I2Sx, NL_GPDMA_ChDesc* desc)
+{
+	if(I2Sx == LPC_I2S0)
+		desc->dstperiph = 9;
+	else if(I2Sx == LPC_I2S1)
+		desc->dstperiph = 3;
+	else
+		return ERROR;
+
+	desc->channel	= GPDMA_I2S_TX_CHANNEL;
+	desc->srcperiph	= 0;
+	desc->dstaddr	= (uint32_t)&I2Sx->TXFIFO;
+	desc->ccontrol	= GPDMA_CCONTROL_SI | GPDMA_CCONTROL_D
+					  | GPDMA_CCONTROL_DWIDTH_WORD | GPDMA_CCONTROL_SWIDTH_WORD
+					  | GPDMA_CCONTROL_DBSIZE_32 | GPDMA_CCONTROL_SBSIZE_32;
+
+	return SUCCESS;
+}
+
+/**********************************************************************
+ * @brief		Channel, peripheral and control of an RX transfer
+ * @param[in]	I2Sx	LPC_I2S0 or LPC_I2S1
+ * @param[out]	desc	descriptor without buffer and length
+ * @return		SUCCESS; ERROR - unknown peripheral
+ **********************************************************************/
+static Status I2S_DMA_RxDesc(LPC_I2Sn_Type *I2Sx, NL_GPDMA_ChDesc* desc)
+{
+	if(I2Sx == LPC_I2S0)
+		desc->srcperiph = 10;
+	else if(I2Sx == LPC_I2S1)
+		desc->srcperiph = 4;
+	else
+		return ERROR;
+
+	desc->channel	= GPDMA_I2S_RX_CHANNEL;
+	desc->dstperiph	= 0;
+	desc->srcaddr	= (uint32_t)&I2Sx->RXFIFO;
+	desc->ccontrol	= GPDMA_CCONTROL_DI | GPDMA_CCONTROL_S
+					  | GPDMA_CCONTROL_DWIDTH_WORD | GPDMA_CCONTROL_SWIDTH_WORD
+					  | GPDMA_CCONTROL_DBSIZE_32 | GPDMA_CCONTROL_SBSIZE_32;
+
+	return SUCCESS;
+}
+
 /**********************************************************************
  * @brief		Sends the desired buffer via I2S using DMA
  * @param[in]	I2SPx	Pointer to selected I2S peripheral, should be:
@@ -156,24 +217,12 @@ uint32_t I2S_DMA_Send(LPC_I2Sn_Type *I2Sx, uint32_t* buff, uint32_t len, Transfe
 {
 	NL_GPDMA_ChDesc desc;
 
-	if(I2Sx == LPC_I2S0) {
-		desc.channel 	= GPDMA_I2S_TX_CHANNEL;
-		desc.dstperiph 	= 9;
-	}
-	else if(I2Sx == LPC_I2S1) {
-		desc.channel 	= GPDMA_I2S_TX_CHANNEL;
-		desc.dstperiph 	= 3;
-	}
-	else
+	if(I2S_DMA_TxDesc(I2Sx, &desc) == ERROR)
 		return 0;
 
 	desc.length		= len;
-	desc.srcperiph 	= 0;
 	desc.srcaddr	= (uint32_t)buff;
-	desc.dstaddr	= (uint32_t)&I2Sx->TXFIFO;
-	desc.ccontrol	= GPDMA_CCONTROL_I | GPDMA_CCONTROL_SI | GPDMA_CCONTROL_D
-					  | GPDMA_CCONTROL_DWIDTH_WORD | GPDMA_CCONTROL_SWIDTH_WORD
-					  | GPDMA_CCONTROL_DBSIZE_32 | GPDMA_CCONTROL_SBSIZE_32;//0x8648000;
+	desc.ccontrol	|= GPDMA_CCONTROL_I;
 
 	if(NL_GPDMA_SetupChannel(&desc, Callback) == ERROR)
 		return 0;
@@ -195,24 +244,12 @@ uint32_t I2S_DMA_Receive(LPC_I2Sn_Type *I2Sx, uint32_t* buff, uint32_t len, Tran
 {
 	NL_GPDMA_ChDesc desc;
 
-	if(I2Sx == LPC_I2S0) {
-		desc.channel 	= GPDMA_I2S_RX_CHANNEL;
-		desc.srcperiph 	= 10;
-	}
-	else if(I2Sx == LPC_I2S1) {
-		desc.channel 	= GPDMA_I2S_RX_CHANNEL;
-		desc.srcperiph 	= 4;
-	}
-	else
+	if(I2S_DMA_RxDesc(I2Sx, &desc) == ERROR)
 		return 0;
 
 	desc.length		= len;
-	desc.dstperiph 	= 0;
 	desc.dstaddr	= (uint32_t)buff;
-	desc.srcaddr	= (uint32_t)&I2Sx->RXFIFO;
-	desc.ccontrol	= GPDMA_CCONTROL_I | GPDMA_CCONTROL_DI | GPDMA_CCONTROL_S
-					  | GPDMA_CCONTROL_DWIDTH_WORD | GPDMA_CCONTROL_SWIDTH_WORD
-					  | GPDMA_CCONTROL_DBSIZE_32 | GPDMA_CCONTROL_SBSIZE_32;//0x8948000;
+	desc.ccontrol	|= GPDMA_CCONTROL_I;
 
 	if(NL_GPDMA_SetupChannel(&desc, Callback) == ERROR)
 		return 0;
@@ -220,6 +257,150 @@ uint32_t I2S_DMA_Receive(LPC_I2Sn_Type *I2Sx, uint32_t* buff, uint32_t len, Tran
 	return len;
 }
 
+/**********************************************************************
+ * @brief		Reports the finished periods of a stream, called by
+ * 				NL_GPDMA_Poll() at the end of each period. Periods which
+ * 				ended before a late poll are reported as well.
+ * @param[in]	dir		I2S_DMA_TX or I2S_DMA_RX
+ * @param[in]	status	SUCCESS; ERROR - the channel has been disabled
+ **********************************************************************/
+static void I2S_DMA_Period(uint8_t dir, uint32_t status)
+{
+	I2S_DMA_STREAM_T* s = &streams[dir];
+	uint32_t current;
+
+	if(s->len == 0)
+		return;
+
+	if(status == ERROR) {
+		s->len = 0;
+		s->callback(0, 0);
+		return;
+	}
+
+	current = I2S_DMA_StreamPos(dir) / s->periodLen;		/* being transferred */
+
+	while(s->next != current) {
+		s->callback(s->buff + s->next * s->periodLen, s->periodLen);
+		s->next = (s->next + 1) % (s->len / s->periodLen);
+	}
+}
+
+static void I2S_DMA_TxPeriod(uint32_t status)
+{
+	I2S_DMA_Period(I2S_DMA_TX, status);
+}
+
+static void I2S_DMA_RxPeriod(uint32_t status)
+{
+	I2S_DMA_Period(I2S_DMA_RX, status);
+}
+
+/**********************************************************************
+ * @brief		Starts a stream: the buffer is transferred in an endless
+ * 				loop of periods without re-arming by the CPU
+ * @param[in]	I2SPx	Pointer to selected I2S peripheral, should be:
+ * 					- LPC_I2S0	:I2S0 peripheral
+ * 					- LPC_I2S1	:I2S1 peripheral
+ * @param[in]	dir		I2S_DMA_TX or I2S_DMA_RX
+ * @param[in]	buff	Pointer to the buffer, periods * periodLen words
+ * @param[in]	periodLen	words per period, at most 4095
+ * @param[in]	periods		2 ... I2S_DMA_MAX_PERIODS
+ * @param[in]	Callback	called from NL_GPDMA_Poll() for each finished
+ * 							period, (0, 0) if a DMA error stopped the
+ * 							stream; NULL: the CPU follows I2S_DMA_StreamPos()
+ * @return		length of the buffer - Success; 0 - Failure
+ **********************************************************************/
+uint32_t I2S_DMA_StartStream(LPC_I2Sn_Type *I2Sx, uint8_t dir, uint32_t* buff, uint32_t periodLen, uint32_t periods,
+							 I2S_DMA_PeriodCallback Callback)
+{
+	I2S_DMA_STREAM_T* s;
+	NL_GPDMA_ChDesc desc;
+	uint32_t i;
+
+	if((dir > I2S_DMA_RX) || (periods < 2) || (periods > I2S_DMA_MAX_PERIODS)
+	   || (periodLen == 0) || (periodLen > 0xFFF))
+		return 0;
+
+	s = &streams[dir];
+
+	if(dir == I2S_DMA_TX) {
+		if(I2S_DMA_TxDesc(I2Sx, &desc) == ERROR)
+			return 0;
+	}
+	else {
+		if(I2S_DMA_RxDesc(I2Sx, &desc) == ERROR)
+			return 0;
+	}
+
+	if(Callback)
+		desc.ccontrol |= GPDMA_CCONTROL_I;
+
+	for(i = 0; i < periods; i++) {
+		if(dir == I2S_DMA_TX) {
+			s->lli[i].srcaddr	= (uint32_t)(buff + i * periodLen);
+			s->lli[i].dstaddr	= desc.dstaddr;
+		}
+		else {
+			s->lli[i].srcaddr	= desc.srcaddr;
+			s->lli[i].dstaddr	= (uint32_t)(buff + i * periodLen);
+		}
+		s->lli[i].next		= (uint32_t)&s->lli[(i + 1) % periods];
+		s->lli[i].ccontrol	= desc.ccontrol | periodLen;
+	}
+
+	desc.length		= periodLen;
+	desc.srcaddr	= s->lli[0].srcaddr;
+	desc.dstaddr	= s->lli[0].dstaddr;
+
+	s->buff			= buff;
+	s->periodLen	= periodLen;
+	s->len			= periods * periodLen;
+	s->next			= 0;
+	s->callback		= Callback;
+
+	if(NL_GPDMA_SetupChannelLLI(&desc, &s->lli[1], Callback ? (dir == I2S_DMA_TX ? I2S_DMA_TxPeriod : I2S_DMA_RxPeriod) : NULL) == ERROR) {
+		s->len = 0;
+		return 0;
+	}
+
+	return s->len;
+}
+
+/**********************************************************************
+ * @brief		Position of a stream
+ * @param[in]	dir		I2S_DMA_TX or I2S_DMA_RX
+ * @return		index of the next word which the DMA transfers,
+ * 				0 if the stream is not running
+ **********************************************************************/
+uint32_t I2S_DMA_StreamPos(uint8_t dir)
+{
+	uint32_t addr;
+
+	if((dir > I2S_DMA_RX) || (streams[dir].len == 0))
+		return 0;
+
+	if(dir == I2S_DMA_TX)
+		addr = NL_GPDMA_SrcAddr(GPDMA_I2S_TX_CHANNEL);
+	else
+		addr = NL_GPDMA_DstAddr(GPDMA_I2S_RX_CHANNEL);
+
+	return ((addr - (uint32_t)streams[dir].buff) / 4) % streams[dir].len;
+}
+
+/**********************************************************************
+ * @brief		Stops a stream, the callback is not called any more
+ * @param[in]	dir		I2S_DMA_TX or I2S_DMA_RX
+ **********************************************************************/
+void I2S_DMA_StopStream(uint8_t dir)
+{
+	if(dir > I2S_DMA_RX)
+		return;
+
+	NL_GPDMA_StopChannel(dir == I2S_DMA_TX ? GPDMA_I2S_TX_CHANNEL : GPDMA_I2S_RX_CHANNEL);
+	streams[dir].len = 0;
+}
+
 /**********************************************************************
  * @brief		Checks whether the TX DMA channel is busy
  * @return		1 - busy; 0 - not busy
@@ -75,10 +75,29 @@
 /** Both input and output master mode */
 #define I2S_MODE_IO_MASTER		1
 
+/*******************************************************************//**
+ * Streams: a buffer of several periods which the DMA transfers in an
+ * endless loop (circular linked list, one item per period). After each
+ * period the callback gets the period which is free now: TX - played,
+ * to be refilled; RX - received. Two periods give ping-pong buffering
+ * with half- and full-buffer callbacks.
+ *********************************************************************/
+#define I2S_DMA_TX				0
+#define I2S_DMA_RX				1
+/** maximum number of periods of a stream */
+#define I2S_DMA_MAX_PERIODS		8
+
+typedef void (*I2S_DMA_PeriodCallback)(uint32_t* buff, uint32_t len);
+
 void I2S_DMA_Init(LPC_I2Sn_Type *I2Sx, uint8_t bits, uint32_t freq, uint8_t mode);
 
 uint32_t I2S_DMA_Send(LPC_I2Sn_Type *I2Sx, uint32_t* buff, uint32_t len, TransferCallback Callback);
 uint32_t I2S_DMA_Receive(LPC_I2Sn_Type *I2Sx, uint32_t* buff, uint32_t len, TransferCallback Callback);
 
 uint32_t I2S_DMA_TxBusy(void);
+
+uint32_t I2S_DMA_StartStream(LPC_I2Sn_Type *I2Sx, uint8_t dir, uint32_t* buff, uint32_t periodLen, uint32_t periods,
+							 I2S_DMA_PeriodCallback Callback);
+uint32_t I2S_DMA_StreamPos(uint8_t dir);
+void I2S_DMA_StopStream(uint8_t dir);
 #endif
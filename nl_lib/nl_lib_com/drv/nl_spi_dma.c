@@ -254,3 +254,83 @@ uint32_t SPI_DMA_ChannelBusy(uint32_t chan)
 {
 	return NL_GPDMA_ChannelBusy((uint8_t)chan);
 }
+
+
+/**********************************************************************
+ * @brief		Checks whether a receive transfer has started (slave mode)
+ * @param[in]	SSPx	Pointer to selected SSP peripheral, should be:
+ * 					- LPC_SSP0	:SSP0 peripheral
+ * 					- LPC_SSP1	:SSP1 peripheral
+ * @param[in]	len		Length of the receive buffer
+ * @return		1 - bytes have been received; 0 - nothing received yet
+ **********************************************************************/
+uint32_t SPI_DMA_RxStarted(LPC_SSPn_Type *SSPx, uint32_t len)
+{
+	uint32_t ch;
+
+	if(SSPx == LPC_SSP0)
+		ch = GPDMA_SPI_0_RX_CHANNEL;
+	else if(SSPx == LPC_SSP1)
+		ch = GPDMA_SPI_1_RX_CHANNEL;
+	else
+		return 0;
+
+	if(SSPx->SR & SSP_SR_RNE)
+		return 1;											// less than a burst, still in the FIFO
+
+	if(NL_GPDMA_ChannelBusy(ch) == 0)
+		return 1;											// finished
+
+	return (NL_GPDMA_Remaining(ch) < len);
+}
+
+
+/**********************************************************************
+ * @brief		Stops a transfer which the master has ended before the
+ * 				full length (slave mode). The bytes still in the RX FIFO are
+ * 				copied behind the received data, the SSP is reset to drop
+ * 				the bytes waiting in the TX FIFO.
+ * @param[in]	SSPx	Pointer to selected SSP peripheral, should be:
+ * 					- LPC_SSP0	:SSP0 peripheral
+ * 					- LPC_SSP1	:SSP1 peripheral
+ * @param[in]	rx_buff	Pointer to the receive buffer of the transfer
+ * @param[in]	len		Length of the receive buffer
+ * @return		number of received bytes
+ **********************************************************************/
+uint32_t SPI_DMA_Abort(LPC_SSPn_Type *SSPx, uint8_t* rx_buff, uint32_t len)
+{
+	uint32_t received;
+	uint32_t rst;
+	uint32_t cr0, cr1, cpsr, dmacr;
+
+	if(SSPx == LPC_SSP0) {
+		NL_GPDMA_StopChannel(GPDMA_SPI_0_TX_CHANNEL);
+		received = len - NL_GPDMA_StopChannel(GPDMA_SPI_0_RX_CHANNEL);
+		rst = 1 << 18;											// SSP0_RST (50)
+	}
+	else if(SSPx == LPC_SSP1) {
+		NL_GPDMA_StopChannel(GPDMA_SPI_1_TX_CHANNEL);
+		received = len - NL_GPDMA_StopChannel(GPDMA_SPI_1_RX_CHANNEL);
+		rst = 1 << 19;											// SSP1_RST (51)
+	}
+	else
+		return 0;
+
+	while((SSPx->SR & SSP_SR_RNE) && (received < len))
+		rx_buff[received++] = SSPx->DR;
+
+	cr0 = SSPx->CR0;
+	cr1 = SSPx->CR1;
+	cpsr = SSPx->CPSR;
+	dmacr = SSPx->DMACR;
+
+	LPC_RGU->RESET_CTRL1 = rst;
+	while((LPC_RGU->RESET_ACTIVE_STATUS1 & rst) == 0);
+
+	SSPx->CR0 = cr0;
+	SSPx->CPSR = cpsr;
+	SSPx->DMACR = dmacr;
+	SSPx->CR1 = cr1;
+
+	return received;
+}
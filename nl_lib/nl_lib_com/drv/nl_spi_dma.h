@@ -46,5 +46,12 @@ uint32_t SPI_DMA_SendReceiveBlocking(	LPC_SSPn_Type *SSPx,
 
 uint32_t SPI_DMA_ChannelBusy(			uint32_t chan);
 
+uint32_t SPI_DMA_RxStarted(				LPC_SSPn_Type *SSPx,
+										uint32_t len);
+
+uint32_t SPI_DMA_Abort(					LPC_SSPn_Type *SSPx,
+										uint8_t* rx_buff,
+										uint32_t len);
+
 #endif /* NL_SPI_DMA_H_ */
 
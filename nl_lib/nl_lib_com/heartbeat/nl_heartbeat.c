@@ -9,6 +9,7 @@
 
 
 #include "heartbeat/nl_heartbeat.h"
+#include "usb/nl_usb_midi_parser.h"
 #include "spibb/nl_bb_msg.h"
 #include "sup/nl_sup.h"
 #include "drv/nl_dbg.h"
@@ -19,40 +20,53 @@ static uint64_t lpcHeartBeat = 0;
 
 
 /******************************************************************************/
-/** @brief		process incoming Midi data (Callback routine for "USB_MIDI_Config()")
-    @param[in]	buff	Pointer to data buffer
-    @param[in]	len		Amount of bytes in buffer
+/** @brief		heartbeat fragment from the audio engine: 0xA0 ... 0xA3 (poly key pressure
+				on channel 1 ... 4), 14 bits each, 0xA2 completes the heartbeat
 *******************************************************************************/
-void HBT_MidiReceive(uint8_t *buff, uint32_t len)
+static void HBT_Fragment(uint8_t cable, uint8_t status, uint8_t data1, uint8_t data2)
 {
-  SUP_MidiTrafficDetected();
+	unsigned long shift = (status & 0x03) * 14;
+
+	uint64_t lsb = data1;
+	uint64_t msb = data2;
+
+	audioEngineHeartBeat = (status == 0xA0) ? 0 : audioEngineHeartBeat;
+	audioEngineHeartBeat |= (msb << shift);
+	audioEngineHeartBeat |= (lsb << (shift + 7));
 
-  buff++;	// first midi byte is in buff[1]
-  if (len)
-	  len--;
-  while(len >= 3)
-  {
-	if ( (buff[0] & 0xFC) == 0xA0)		// command byte is 0xA0 ... 0xA3 ?
+	if(status == 0xA2)
 	{
-		unsigned long shift = (buff[0] & 0x03) * 14;
+	  uint64_t chainHeartbeat = audioEngineHeartBeat + lpcHeartBeat;
+	  BB_MSG_WriteMessage(BB_MSG_TYPE_HEARTBEAT, 4, (uint16_t *) &chainHeartbeat);
+	  lpcHeartBeat++;
+	}
+}
 
-		uint64_t lsb = *(buff + 1);
-		uint64_t msb = *(buff + 2);
 
-		audioEngineHeartBeat = (buff[0] == 0xA0) ? 0 : audioEngineHeartBeat;
-		audioEngineHeartBeat |= (msb << shift);
-		audioEngineHeartBeat |= (lsb << (shift + 7));
+/******************************************************************************/
+/** @brief		sets up the USB-MIDI parser with the handlers for the inbound traffic
+*******************************************************************************/
+void HBT_Init(void)
+{
+  uint8_t status;
 
+  USB_MIDI_PARSER_Init();
 
-		if(buff[0] == 0xA2)
-		{
-		  uint64_t chainHeartbeat = audioEngineHeartBeat + lpcHeartBeat;
-		  BB_MSG_WriteMessage(BB_MSG_TYPE_HEARTBEAT, 4, (uint16_t *) &chainHeartbeat);
-		  lpcHeartBeat++;
-		}
-	}
-    len -= 3;
-  }
+  for (status = 0xA0; status <= 0xA3; status++)
+	  USB_MIDI_PARSER_SetHandler(status, HBT_Fragment);
+}
+
+
+/******************************************************************************/
+/** @brief		process incoming Midi data (Callback routine for "USB_MIDI_Config()")
+    @param[in]	buff	Pointer to data buffer
+    @param[in]	len		Amount of bytes in buffer
+*******************************************************************************/
+void HBT_MidiReceive(uint8_t *buff, uint32_t len)
+{
+  SUP_MidiTrafficDetected();
+
+  USB_MIDI_PARSER_Parse(buff, len);
 }
 
 // EOF
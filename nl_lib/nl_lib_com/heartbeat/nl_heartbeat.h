@@ -13,6 +13,7 @@
 #include <stdint.h>
 
 
+void HBT_Init(void);
 void HBT_MidiReceive(uint8_t* buff, uint32_t len);
 
 #endif /* nl_heartbeat.h */
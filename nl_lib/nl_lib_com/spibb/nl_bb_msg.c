@@ -11,182 +11,229 @@
 #include "tcd/nl_tcd_param_work.h"
 #include "tcd/nl_tcd_adc_work.h"
 #include "tcd/nl_tcd_poly.h"
+#include "tcd/nl_tcd_preset_cache.h"
 #include "dbg/nl_assert.h"
 
-#define SENDBUFFER_SIZE  510						// 16-bit words, stays below the maximum of 1020 bytes
+#define CMD_BUDGET			32						// received commands applied per tick (a preset is only copied and applied by PARAM_WORK_Process)
 
-static uint16_t sendBuffer[SENDBUFFER_SIZE] = {};
-static uint32_t sendBufferLen = 0;					// behind the 4-byte header
+static uint32_t presetPending = 0;					// a preset recall is running, the following commands have to wait for it
+static uint32_t shortMessages = 0;					// ignored because of a missing argument
 
 
 
 /**********************************************************************
- * @brief		Writing a generic message into the SPI send buffer
+ * Outgoing messages wait in one of three lanes (word rings of type, length
+ * and values). BB_MSG_FlushLanes moves them into the TX packages of the
+ * SPI-BB driver in the order of the lanes, so a flood of bulk messages
+ * (e.g. hardware sources) can not delay edit control messages or the
+ * heartbeat. A lane only blocks itself when it is full.
+ **********************************************************************/
+
+static uint16_t laneBuffer[BB_MSG_NUM_LANES][BB_MSG_LANE_SIZE];
+static uint32_t laneHead[BB_MSG_NUM_LANES];				// free-running, written by BB_MSG_WriteMessage
+static uint32_t laneTail[BB_MSG_NUM_LANES];				// free-running, read by BB_MSG_FlushLanes
+static uint32_t laneDropped[BB_MSG_NUM_LANES];
+
+#define LANE_MASK	(BB_MSG_LANE_SIZE - 1)
+#define MAX_LENGTH	(SPI_BB_BUFFER_SIZE / 2 - 6)		// values of a message filling a whole package (8 bytes package header, 4 bytes message header)
+
+
+
+static uint32_t Lane(uint16_t type)
+{
+	switch (type)
+	{
+		case BB_MSG_TYPE_EDIT_CONTROL:
+			return BB_MSG_LANE_EDIT;
+		case BB_MSG_TYPE_HEARTBEAT:
+			return BB_MSG_LANE_HEARTBEAT;
+		default:
+			return BB_MSG_LANE_BULK;					// parameters of the hardware sources, notifications, assertions
+	}
+}
+
+
+
+/**********************************************************************
+ * @brief		Moves the waiting messages into the TX packages of the SPI-BB
+ * 				driver, lane by lane, until the packages are full
+ **********************************************************************/
+
+static void BB_MSG_FlushLanes(void)
+{
+	uint32_t lane;
+	uint32_t i;
+	uint16_t type;
+	uint16_t length;
+	uint16_t* values;
+
+	for (lane = 0; lane < BB_MSG_NUM_LANES; lane++)
+	{
+		while (laneTail[lane] != laneHead[lane])
+		{
+			type = laneBuffer[lane][laneTail[lane] & LANE_MASK];
+			length = laneBuffer[lane][(laneTail[lane] + 1) & LANE_MASK];
+
+			values = SPI_BB_ReserveMessage(type, length);
+
+			if (values == NULL)
+			{
+				return;									// the lanes behind have to wait as well
+			}
+
+			for (i = 0; i < length; i++)
+			{
+				values[i] = laneBuffer[lane][(laneTail[lane] + 2 + i) & LANE_MASK];
+			}
+
+			laneTail[lane] += 2 + length;
+		}
+	}
+}
+
+
+
+/**********************************************************************
+ * @brief		Writing a generic message into the lane of its type
  * @param[in]	type	message type (see defines)
  * @param[in]	length	number of 16-bit data fields
  * @param[in]	data	pointer to an array of 16-bit data fields
- * @return		>= 0: "success" and remaining buffer space
- * 				-1: "buffer is full, try again later"
+ * @return		>= 0: "success" and remaining space of the lane
+ * 				-1: "lane is full, try again later"
  *
  * 				NOTE: NO ASSERTION IN THIS FUNCTION => RECURSION
  **********************************************************************/
 
 int32_t BB_MSG_WriteMessage(uint16_t type, uint16_t length, uint16_t* data)
 {
-	int32_t remainingBuffer = SENDBUFFER_SIZE - (sendBufferLen + length + 2);
+	uint32_t lane = Lane(type);
+	uint32_t space = BB_MSG_LANE_SIZE - (laneHead[lane] - laneTail[lane]);
+	uint32_t head = laneHead[lane];
+	uint32_t i;
 
-	if (remainingBuffer < 0)
+	if ( (length > MAX_LENGTH) || ((uint32_t)(2 + length) > space) )
 	{
-		return -1;		// buffer is full
+		laneDropped[lane]++;
+		return -1;		// lane is full
 	}
 
-	sendBuffer[sendBufferLen] = type;
-	sendBufferLen++;
-	sendBuffer[sendBufferLen] = length;
-	sendBufferLen++;
+	laneBuffer[lane][head & LANE_MASK] = type;
+	laneBuffer[lane][(head + 1) & LANE_MASK] = length;
 
-	if (data != NULL)
+	for (i = 0; i < length; i++)
 	{
-		uint32_t i;
-
-		for (i = 0; i < length; i++)
-		{
-			sendBuffer[sendBufferLen] = data[i];
-			sendBufferLen++;
-		}
+		laneBuffer[lane][(head + 2 + i) & LANE_MASK] = (data != NULL) ? data[i] : 0;
 	}
 
-	return remainingBuffer;
+	laneHead[lane] = head + 2 + length;
+
+	return space - (2 + length);
 }
 
 
 /**********************************************************************
- * @brief		Writes a message with 2 arguments into the send buffer
+ * @brief		Writes a message with 2 arguments into the lane of its type
  * @param[in]	type	message type (see defines)
  * @param[in]	arg0	e.g. the identifier of a parameter
  * @param[in]	arg1	e.g. the value of the parameter
- * @return		>= 0: "success" and remaining buffer space
- * 				-1: "buffer is full, try again later"
+ * @return		>= 0: "success" and remaining space of the lane
+ * 				-1: "lane is full, try again later"
  **********************************************************************/
 
 int32_t BB_MSG_WriteMessage2Arg(uint16_t type, uint16_t arg0, uint16_t arg1)
 {
-	int32_t remainingBuffer = SENDBUFFER_SIZE - (sendBufferLen + 4);
-
-	if (remainingBuffer < 0)
-	{
-		return -1;		// buffer is full
-	}
-
-	sendBuffer[sendBufferLen] = type;
-	sendBufferLen++;
-	sendBuffer[sendBufferLen] = 2;
-	sendBufferLen++;
-
-	sendBuffer[sendBufferLen] = arg0;
-	sendBufferLen++;
+	uint16_t data[2];
 
-	sendBuffer[sendBufferLen] = arg1;
-	sendBufferLen++;
+	data[0] = arg0;
+	data[1] = arg1;
 
-	NL_ASSERT(sendBufferLen < SENDBUFFER_SIZE);
-
-	return remainingBuffer;
+	return BB_MSG_WriteMessage(type, 2, data);
 }
 
 
 /**********************************************************************
- * @brief		Writes a message with 1 argument into the send buffer
+ * @brief		Writes a message with 1 argument into the lane of its type
  * @param[in]	type	message type (see defines)
  * @param[in]	arg		e.g. the morph position
- * @return		>= 0: "success" and remaining buffer space
- * 				-1: "buffer is full, try again later"
+ * @return		>= 0: "success" and remaining space of the lane
+ * 				-1: "lane is full, try again later"
  **********************************************************************/
 
 int32_t BB_MSG_WriteMessage1Arg(uint16_t type, uint16_t arg)
 {
-	int32_t remainingBuffer = SENDBUFFER_SIZE - (sendBufferLen + 3);
-
-	if (remainingBuffer < 0)
-	{
-		return -1;		// buffer is full
-	}
+	return BB_MSG_WriteMessage(type, 1, &arg);
+}
 
-	sendBuffer[sendBufferLen] = type;
-	sendBufferLen++;
-	sendBuffer[sendBufferLen] = 1;
-	sendBufferLen++;
 
-	sendBuffer[sendBufferLen] = arg;
-	sendBufferLen++;
+/**********************************************************************
+ * @brief		Writes a message without arguments into the lane of its type
+ * @param[in]	type	message type (see defines)
+ * @return		>= 0: "success" and remaining space of the lane
+ * 				-1: "lane is full, try again later"
+ **********************************************************************/
 
-	return remainingBuffer;
+int32_t BB_MSG_WriteMessageNoArg(uint16_t type)
+{
+	return BB_MSG_WriteMessage(type, 0, NULL);		// no data fields
 }
 
 
+
 /**********************************************************************
- * @brief		Writes a message with 1 argument into the send buffer
- * @param[in]	type	message type (see defines)
- * @return		>= 0: "success" and remaining buffer space
- * 				-1: "buffer is full, try again later"
+ * @brief		Moves the waiting messages into the TX packages of the SPI-BB
+ * 				driver, they go out with the next transfer. BB_MSG_ProcessCommands
+ * 				does the same every tick.
+ * @return		0 = "nothing to send"
+ *              number of bytes waiting for the next transfer
  **********************************************************************/
 
-int32_t BB_MSG_WriteMessageNoArg(uint16_t type)
+int32_t BB_MSG_SendTheBuffer(void)
 {
-	int32_t remainingBuffer = SENDBUFFER_SIZE - (sendBufferLen + 1);
+	BB_MSG_FlushLanes();
+
+	return SPI_BB_TxPending();
+}
 
-	if (remainingBuffer < 0)
-	{
-		return -1;		// buffer is full
-	}
 
-	sendBuffer[sendBufferLen] = (type << 16);	// no data fields
-	sendBufferLen++;
+/**********************************************************************
+ * @return		number of messages which did not fit into the lane
+ **********************************************************************/
 
-	return remainingBuffer;
+uint32_t BB_MSG_GetDropped(uint32_t lane)
+{
+	return (lane < BB_MSG_NUM_LANES) ? laneDropped[lane] : 0;
 }
 
 
 
 /**********************************************************************
- * @brief		Sending a package with one or more messages via SPI
- * @return		buffer length in bytes - success
- *              0 = "nothing to send"
- *              -1 = "failure, try again later"
- *              sendBufferLen*2 = "success"
+ * @return		number of received messages which were too short
  **********************************************************************/
 
-int32_t BB_MSG_SendTheBuffer(void)
+uint32_t BB_MSG_GetShortMessages(void)
 {
-	if (sendBufferLen == 0)
-	{
-		return 0;	// nothing to send
-	}
+	return shortMessages;
+}
 
-	uint8_t* buff = (uint8_t*)sendBuffer;
 
-	uint32_t success = SPI_BB_Send(buff, sendBufferLen * 2);
 
-	if (success)
-	{
-		sendBufferLen = 0;	// position for first messages of next buffer (behind the header)
+/*****************************************************************************
+ * @brief		PresetApplied - completion callback of the preset recall
+ *****************************************************************************/
 
-		return success;
-	}
-	else	// sending failed, try again later
-	{
-		return -1;
-	}
+static void PresetApplied(void)
+{
+	presetPending = 0;
 }
 
 
 
 /*****************************************************************************
- * @brief		BB_MSG_ReceiveCallback - Callback for receiving messages from
- * the Beaglebone (called from the PackageParser of the spi_bb driver).
+ * @brief		ApplyCommand - applies a message from the Beaglebone to the TCD
+ * engine (called by BB_MSG_ProcessCommands).
  *****************************************************************************/
 
-void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t* data)
+static void ApplyCommand(uint16_t type, uint16_t length, uint16_t* data)
 {
 	// data[0]	- parameter id
 	// data[1]  - first value
@@ -205,7 +252,51 @@ void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t* data)
 	}
 	else if (type == BB_MSG_TYPE_PRESET_DIRECT)
 	{
-		PARAM_ApplyPreset(length, data);
+		presetPending = 1;
+		PARAM_ApplyPreset(length, data, PresetApplied);
+	}
+	else if (type == BB_MSG_TYPE_PRESET_STORE)
+	{
+		if (length > 1)
+		{
+			PRESET_CACHE_Store(data[0], length - 1, &data[1]);
+		}
+	}
+	else if (type == BB_MSG_TYPE_PRESET_RECALL)
+	{
+		uint16_t presetLength;
+		uint16_t* preset;
+
+		if (length < 2)
+		{
+			shortMessages++;
+			return;
+		}
+
+		preset = PRESET_CACHE_Find(data[0], data[1], &presetLength);
+
+		if (preset)
+		{
+			presetPending = 1;
+			PARAM_ApplyPreset(presetLength, preset, PresetApplied);
+		}
+		else
+		{
+			BB_MSG_WriteMessage2Arg(BB_MSG_TYPE_NOTIFICATION, NOTIFICATION_ID_PRESET_CACHE_MISS, data[0]);
+			BB_MSG_SendTheBuffer();
+		}
+	}
+	else if (type == BB_MSG_TYPE_MORPH_SET_A)
+	{
+		PARAM_SetMorphA(length, data);
+	}
+	else if (type == BB_MSG_TYPE_MORPH_SET_B)
+	{
+		PARAM_SetMorphB(length, data);
+	}
+	else if (type == BB_MSG_TYPE_MORPH_POS)
+	{
+		PARAM_SetMorphPos(data[0]);						// 0: A ... 16000: B
 	}
 	else if (type == BB_MSG_TYPE_SETTING)
 	{
@@ -242,16 +333,16 @@ void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t* data)
 				ADC_WORK_SetRibbonRelFactor(data[1]);			// factor = data[1] / 256
 				break;
 			case 11:										// Velocity Curve
-				POLY_Generate_VelTable(data[1]);					// Parameter: 0 = very soft ... 4 = very hard
+				POLY_Select_VelTable(data[1]);					// Parameter: 0 = very soft ... 4 = very hard
 				break;
 			case 12:										// Transition Time
 				PARAM_SetTransitionTime(data[1]);
 				break;
 			case 30:										// Aftertouch Curve
-				ADC_WORK_Generate_AftertouchTable(data[1]); 	// 0: soft, 1: normal, 2: hard
+				ADC_WORK_Select_AftertouchTable(data[1]); 	// 0: soft, 1: normal, 2: hard
 				break;
 			case 31:										// Bender Curve
-				ADC_WORK_Generate_BenderTable(data[1]);			// 0: soft, 1: normal, 2: hard
+				ADC_WORK_Select_BenderTable(data[1]);			// 0: soft, 1: normal, 2: hard
 				break;
 			case 32:										// Pitchbend on Pressed Keys
 				break;
@@ -261,6 +352,15 @@ void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t* data)
 			case 34:										// Glitch Suppression
 				PARAM_SetGlitchSuppression(data[1]);			// 0: off, 1: on
 				break;
+			case 35:										// MC Update Interval
+				PARAM_SetUpdateInterval(NUM_UI_PARAMS, data[1]);	// for all targets, 0 ... 65535 [125 us]
+				break;
+			case 36:										// Preset Recall Budget
+				PARAM_SetPresetBudget(data[1]);					// parameters per tick, 1 ... 324
+				break;
+			case 37:										// Packed Hardware Sources
+				ADC_WORK_SetPackedHWMessages(data[1]);			// 0: off, 1: on
+				break;
 			default:
 				/// Error
 				break;
@@ -273,5 +373,79 @@ void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t* data)
 			BB_MSG_WriteMessage2Arg(BB_MSG_TYPE_NOTIFICATION, NOTIFICATION_ID_SW_VERSION, SW_VERSION);  // sending the software version to the BB
 			BB_MSG_SendTheBuffer();
 		}
+		else if (data[0] == REQUEST_ID_PRESET_CACHE_STATS)
+		{
+			uint32_t hits = PRESET_CACHE_GetHits();
+			uint32_t misses = PRESET_CACHE_GetMisses();
+			uint16_t stats[3];
+
+			stats[0] = NOTIFICATION_ID_PRESET_CACHE_STATS;
+			stats[1] = (hits > 0xFFFF) ? 0xFFFF : hits;
+			stats[2] = (misses > 0xFFFF) ? 0xFFFF : misses;
+
+			BB_MSG_WriteMessage(BB_MSG_TYPE_NOTIFICATION, 3, stats);
+			BB_MSG_SendTheBuffer();
+		}
+#ifdef SPI_BB_BENCHMARK
+		else if (data[0] == REQUEST_ID_SPI_BB_BENCHMARK)
+		{
+			const SPI_BB_BENCH_RESULT_T* bench = SPI_BB_GetBenchmark();
+			uint32_t values[5] = { bench->txBytesPerSec, bench->rxBytesPerSec, bench->transfersPerSec, bench->avgLatencyUs, bench->maxLatencyUs };
+			uint16_t result[11];
+			uint32_t i;
+
+			result[0] = NOTIFICATION_ID_SPI_BB_BENCHMARK;
+
+			for (i = 0; i < 5; i++)
+			{
+				result[1 + 2 * i] = values[i] & 0xFFFF;
+				result[2 + 2 * i] = values[i] >> 16;
+			}
+
+			BB_MSG_WriteMessage(BB_MSG_TYPE_NOTIFICATION, 11, result);
+			BB_MSG_SendTheBuffer();
+		}
+#endif
 	}
 }
+
+
+
+/*****************************************************************************
+ * @brief		BB_MSG_ProcessCommands - applies the received commands in the
+ * order of arrival, limited by CMD_BUDGET per call. The messages are read in
+ * place from the receive buffers of the SPI-BB driver.
+ * While a preset recall is running, the commands behind it wait, so their
+ * receive buffers stay held for the duration of the recall (11 ticks or
+ * 1.4 ms with the default budget of PARAM_SetPresetBudget). When all buffers
+ * are held, the driver does not set RDY and the BB waits. The preset itself
+ * has been copied, its buffer is released.
+ * Afterwards the outgoing lanes are moved into the TX packages.
+ * COOS task, every 125 us
+ *****************************************************************************/
+
+void BB_MSG_ProcessCommands(void)
+{
+	uint32_t budget = CMD_BUDGET;
+	uint16_t type;
+	uint16_t length;
+	uint16_t* data;
+
+	while ( (budget > 0) && (presetPending == 0) )
+	{
+		data = SPI_BB_PeekMessage(&type, &length);
+
+		if (data == NULL)
+		{
+			break;
+		}
+
+		ApplyCommand(type, length, data);
+
+		SPI_BB_ReleaseMessage();						// the buffer goes back to the DMA after its last message
+
+		budget--;
+	}
+
+	BB_MSG_FlushLanes();
+}
@@ -23,6 +23,9 @@
 #define BB_MSG_TYPE_ASSERTION 0x0900
 #define BB_MSG_TYPE_REQUEST 0x0A00
 #define BB_MSG_TYPE_HEARTBEAT 0x0B00
+#define BB_MSG_TYPE_PRESET_STORE 0x0C00   // preset Id, followed by the preset
+#define BB_MSG_TYPE_PRESET_RECALL 0x0D00  // preset Id, checksum (Fletcher-16, see PRESET_CACHE_Checksum)
+#define BB_MSG_TYPE_HW_SOURCES 0x0E00     // LPC -> BB: bitmap of the hardware sources (bit 0: pedal 1 ... bit 7: ribbon 2), followed by their values
 
 //----- Setting Ids:
 
@@ -57,19 +60,36 @@
 #define SETTING_ID_PITCHBEND_ON_PRESSED_KEYS 32  // OFF = 0, ON = 1
 #define SETTING_ID_EDIT_SMOOTHING_TIME 33        // ==> tTcdRange(0, 16000)
 #define SETTING_ID_PRESET_GLITCH_SUPPRESSION 34  // OFF = 0, ON = 1
+#define SETTING_ID_MC_UPDATE_INTERVAL 35         // ==> minimum time between two MC updates of a parameter, 0 ... 65535 [125 us]
+#define SETTING_ID_PRESET_RECALL_BUDGET 36       // ==> parameters applied per tick during a preset recall, 1 ... 324
+#define SETTING_ID_HW_SOURCES_PACKED 37          // ==> OFF = 0 (PARAMETER messages), ON = 1 (HW_SOURCES messages)
 
 //----- Request Ids:
 
 #define REQUEST_ID_SW_VERSION 0x0000
+#define REQUEST_ID_PRESET_CACHE_STATS 0x0001
+#define REQUEST_ID_SPI_BB_BENCHMARK 0x0002    // only with SPI_BB_BENCHMARK
 
 //----- Notification Ids:
 
 #define NOTIFICATION_ID_SW_VERSION 0x0000
+#define NOTIFICATION_ID_PRESET_CACHE_MISS 0x0001   // preset Id: the BB has to send the preset with PRESET_DIRECT or PRESET_STORE
+#define NOTIFICATION_ID_PRESET_CACHE_STATS 0x0002  // hits, misses (saturated at 65535)
+#define NOTIFICATION_ID_SPI_BB_BENCHMARK 0x0003    // tx bytes/s, rx bytes/s, transfers/s, avg. and max. ACK latency [us], each as low and high word
 
 //===========================
 
 #define SW_VERSION 111
 
+//----- outgoing lanes, filled into the SPI packages in this order:
+
+#define BB_MSG_LANE_EDIT		0		// edit control (real-time)
+#define BB_MSG_LANE_HEARTBEAT	1
+#define BB_MSG_LANE_BULK		2		// hardware sources, notifications, assertions
+#define BB_MSG_NUM_LANES		3
+
+#define BB_MSG_LANE_SIZE		512		// words per lane, power of 2
+
 //===========================
 
 int32_t BB_MSG_WriteMessage(uint16_t type, uint16_t length, uint16_t *data);
@@ -78,7 +98,9 @@ int32_t BB_MSG_WriteMessage1Arg(uint16_t type, uint16_t arg);
 int32_t BB_MSG_WriteMessageNoArg(uint16_t type);
 
 int32_t BB_MSG_SendTheBuffer(void);
+uint32_t BB_MSG_GetDropped(uint32_t lane);
+uint32_t BB_MSG_GetShortMessages(void);
 
-void BB_MSG_ReceiveCallback(uint16_t type, uint16_t length, uint16_t *data);
+void BB_MSG_ProcessCommands(void);
 
 #endif /* NL_DRV_NL_BB_MSG_H_ */
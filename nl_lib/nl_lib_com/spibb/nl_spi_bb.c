@@ -5,28 +5,33 @@
     @example
     @ingroup  	SPI_BB
     @author		Nemanja Nikodijevic 2014-01-31
+
+    Protocol v1: 4-byte header 0xFF / size / 0xFF, followed by the messages.
+    Protocol v2: 8-byte header starting with 0xFE, with the sequence number
+    of the package, the ACK for the packages of the other side and a CRC-16.
+    Packages without ACK are sent again (go-back-N). The LPC answers in v2 as
+    soon as it has received a valid v2 package and falls back to v1 when the
+    BB sends v1 again.
+    The length of a transfer is set by the BB (CS going up). In v2 the LPC
+    sends only the header and the payload of its package, the BB clocks at
+    least as many bytes as the size in the header announces, a package which
+    was not clocked completely is sent again with the next transfer.
 *******************************************************************************/
 
 #include "spibb/nl_spi_bb.h"
 #include "drv/nl_gpio.h"
 #include "cmsis/lpc43xx_ssp.h"
-#include "string.h"
 #include "dbg/nl_assert.h"
 
 static LPC_SSPn_Type *BB_SSP;
 static SPI_BB_PINS_T* pins;
-static MessageCallback SPI_BB_MsgCb = NULL;
-static uint8_t* SPI_BB_CurrentBuffer = 0;
-/** rx buffers */
-static uint8_t SPI_BB_Buffers[SPI_BB_BUFFER_NUM][SPI_BB_BUFFER_SIZE];
-static uint8_t SPI_BB_BufferState[SPI_BB_BUFFER_NUM];
-/** tx buffers */
-static uint8_t tx_buff[2][SPI_BB_BUFFER_SIZE];
-static uint16_t tx_buff_offset = 0;
-static uint8_t tx_cur_buff = 0;
-static uint8_t tx_prq = 0;
-
-#define PACKAGE_ENCLOSURE 0xFF
+
+#define PACKAGE_ENCLOSURE 0xFF						// v1: first and last byte of the header
+#define PACKAGE_MARKER_V2 0xFE						// v2: first byte of the header
+
+#define SPI_BB_HEADER_SIZE		8					// every TX package has room for the v2 header
+#define SEQ_WINDOW				16					// maximum distance of a duplicate or a package behind a gap
+#define RETRANSMIT_TICKS		80					// 10 ms without ACK: sending the package again
 
 typedef struct __attribute__((__packed__))
 {
@@ -35,6 +40,16 @@ typedef struct __attribute__((__packed__))
 	uint8_t  post;
 } raw_package_header_t;
 
+typedef struct __attribute__((__packed__))
+{
+	uint8_t  marker;
+	uint8_t  seq;									// sequence number of the package
+	uint16_t size_in_bytes;
+	uint8_t  ack;									// sequence number of the next package expected from the other side
+	uint8_t  ack_inv;								// ~ack
+	uint16_t crc;									// CRC-16-CCITT over the payload and the first 6 bytes of the header
+} raw_package_header_v2_t;
+
 typedef struct __attribute__((__packed__))
 {
 	uint16_t type;
@@ -47,160 +62,363 @@ typedef struct __attribute__((__packed__))
 	uint16_t values[1];
 } msg_t;
 
+/** rx buffers: ring, filled by the DMA in the order of rx_head, parsed in the order of rx_tail */
+static uint8_t SPI_BB_Buffers[SPI_BB_BUFFER_NUM][SPI_BB_BUFFER_SIZE] __attribute__((aligned(4)));
+static volatile uint8_t SPI_BB_BufferState[SPI_BB_BUFFER_NUM];
+static uint16_t rx_start[SPI_BB_BUFFER_NUM];		// position of the first message (behind the header)
+static uint16_t rx_size[SPI_BB_BUFFER_NUM];			// bytes of messages
+static uint32_t rx_head = 0;						// next buffer for the DMA
+static uint32_t rx_dma = 0;							// buffer currently receiving
+static uint32_t rx_tail = 0;						// oldest received buffer
+static uint32_t rx_pos = 0;							// read position in the oldest buffer (bytes behind the header)
+static uint8_t rx_expected = 0;						// v2: sequence number of the next package from the BB
+
+/** tx buffers: ring, the messages are written in place into the package tx_fill,
+ *  tx_tail ... tx_fill-1 are closed and wait for their ACK, tx_next is the next one to send */
+static uint8_t tx_buff[SPI_BB_TX_NUM][SPI_BB_BUFFER_SIZE + 4] __attribute__((aligned(4)));	// a v1 package starts at byte 4
+static uint16_t tx_size[SPI_BB_TX_NUM];
+static uint16_t tx_crc[SPI_BB_TX_NUM];				// CRC of the payload
+static uint8_t tx_seq[SPI_BB_TX_NUM];
+static uint32_t tx_time[SPI_BB_TX_NUM];				// tick of the last sending
+static uint32_t tx_fill = 0;
+static uint32_t tx_next = 0;
+static uint32_t tx_tail = 0;
+static uint16_t tx_buff_offset = SPI_BB_HEADER_SIZE;
+static uint8_t tx_seq_next = 0;
+static uint32_t tx_sent = 0;						// v2: package of the running transfer
+static uint32_t tx_sent_len = 0;					// v2: bytes the BB has to clock for it, 0: no package in the transfer
+static uint8_t tx_ack_buff[SPI_BB_BUFFER_SIZE] __attribute__((aligned(4)));		// empty package, v2: only carrying the ACK
+
+static uint32_t rx_active = 0;						// a transfer is armed and not handled yet
+
+static uint32_t link_v2 = 0;
+static uint32_t tick = 0;
+static SPI_BB_STATS_T stats;
+
+#ifdef SPI_BB_BENCHMARK
+#define SPI_BB_BENCH_TICKS		8000				// 1 s
+
+static SPI_BB_BENCH_RESULT_T bench;
+static uint32_t tx_close[SPI_BB_TX_NUM];			// tick of closing the package
+static uint32_t bench_start = 0;
+static uint32_t bench_tx_bytes = 0;
+static uint32_t bench_rx_bytes = 0;
+static uint32_t bench_transfers = 0;
+static uint32_t bench_latency_sum = 0;				// in ticks
+static uint32_t bench_latency_num = 0;
+static uint32_t bench_latency_max = 0;
+#endif
+
+static const uint16_t crcTable[256] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+
+static uint16_t SPI_BB_Crc(uint16_t crc, uint8_t* data, uint32_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		crc = (crc << 8) ^ crcTable[(crc >> 8) ^ data[i]];
+	}
 
-#if 1
+	return crc;
+}
 
-/// static char log[128][32] = {};		/// Test für verloren gegangene Messages
-/// static int logIdx = 0;
 
-// calls the initialized callback for every message
-static void SPI_BB_PackageParser(uint8_t* buff, uint32_t len)
+// closing the package which is filled; the caller checks that the ring has room for it
+static void SPI_BB_ClosePackage(void)
 {
-	/// memcpy(log[logIdx % 128], buff, MIN(len, 32));	/// Test für verloren gegangene Messages
-	/// logIdx++;
+	uint32_t i = tx_fill % SPI_BB_TX_NUM;
 
-	uint32_t i;
+	tx_size[i] = tx_buff_offset - SPI_BB_HEADER_SIZE;
+	tx_crc[i] = SPI_BB_Crc(0xFFFF, tx_buff[i] + SPI_BB_HEADER_SIZE, tx_size[i]);
+	tx_seq[i] = tx_seq_next;
+#ifdef SPI_BB_BENCHMARK
+	tx_close[i] = tick;
+#endif
+
+	if (link_v2)
+	{
+		tx_seq_next++;									// v1 packages don't use sequence numbers
+	}
+
+	tx_fill++;
+	tx_buff_offset = SPI_BB_HEADER_SIZE;
+}
 
-	raw_package_header_t* rawPackage = (raw_package_header_t *) buff;
-	uint32_t todo = rawPackage->size_in_bytes;
 
-	if ((rawPackage->post == PACKAGE_ENCLOSURE) && (rawPackage->pre == PACKAGE_ENCLOSURE) && (todo <= (len-4)))
+#ifdef SPI_BB_BENCHMARK
+static void SPI_BB_BenchLatency(uint32_t i)
+{
+	uint32_t latency = tick - tx_close[i];
+
+	bench_latency_sum += latency;
+	bench_latency_num++;
+
+	if (latency > bench_latency_max)
 	{
-		buff += 4;
+		bench_latency_max = latency;
+	}
+}
+#endif
 
-		for(i = 0; i < todo; i++)
-		{
-			msg_t* package = (msg_t*) buff;
 
-			if (SPI_BB_MsgCb != NULL)
-			{
-				SPI_BB_MsgCb(package->header.type, package->header.length, package->values);
-			}
+static void SPI_BB_SendTxBuff(void)
+{
+	uint32_t i;
+	uint8_t* package;
+	uint32_t len;
 
-			uint32_t done = sizeof(msg_header_t) + sizeof(uint16_t) * package->header.length;
+	if ( link_v2 && (tx_tail != tx_next) && ((tick - tx_time[tx_tail % SPI_BB_TX_NUM]) >= RETRANSMIT_TICKS) )
+	{
+		stats.retransmits += tx_next - tx_tail;
+		tx_next = tx_tail;								// go-back-N: sending all unacknowledged packages again
+	}
 
-			i += done;
-			buff += done;
-		}
+	if ( (tx_next == tx_fill) && (tx_buff_offset > SPI_BB_HEADER_SIZE) && ((tx_fill - tx_tail) < (SPI_BB_TX_NUM - 1)) )
+	{
+		SPI_BB_ClosePackage();
 	}
 
-	//  when the parsing for the buffer is finished
-	for (i = 0; i < SPI_BB_BUFFER_NUM; i++)
+	tx_sent_len = 0;
+
+	if (link_v2 == 0)
 	{
-		if (rawPackage == (raw_package_header_t*)SPI_BB_Buffers[i])			/// Suche nicht nötig !!!
+		raw_package_header_t* rawPackage;
+
+		if (tx_next != tx_fill)
+		{
+			i = tx_next % SPI_BB_TX_NUM;
+			package = tx_buff[i] + 4;
+			rawPackage = (raw_package_header_t *) package;
+			rawPackage->size_in_bytes = tx_size[i];
+#ifdef SPI_BB_BENCHMARK
+			SPI_BB_BenchLatency(i);
+			bench_tx_bytes += tx_size[i];
+#endif
+			tx_next++;									// v1 packages are sent only once
+			tx_tail = tx_next;
+		}
+		else
 		{
-			SPI_BB_BufferState[i] = SPI_BB_BUFFER_FREE;
-			break;
+			package = tx_ack_buff;						// empty package
+			rawPackage = (raw_package_header_t *) package;
+			rawPackage->size_in_bytes = 0;
 		}
+
+		rawPackage->pre = rawPackage->post = PACKAGE_ENCLOSURE;
+
+		SPI_DMA_Send(BB_SSP, package, SPI_BB_BUFFER_SIZE, NULL);		// the v1 BB always clocks the whole buffer
+		return;
 	}
-}
-#endif
 
+	uint16_t crc;
+	raw_package_header_v2_t* rawPackage;
 
+	if (tx_next != tx_fill)
+	{
+		i = tx_next % SPI_BB_TX_NUM;
+
+		package = tx_buff[i];
+		rawPackage = (raw_package_header_v2_t *) package;
+		rawPackage->seq = tx_seq[i];
+		rawPackage->size_in_bytes = tx_size[i];
+		crc = tx_crc[i];
+		len = SPI_BB_HEADER_SIZE + tx_size[i];
+
+		tx_time[i] = tick;
+		tx_sent = tx_next;
+		tx_sent_len = len;
+		tx_next++;
+	}
+	else
+	{
+		package = tx_ack_buff;
+		rawPackage = (raw_package_header_v2_t *) package;
+		rawPackage->seq = tx_seq_next;
+		rawPackage->size_in_bytes = 0;
+		crc = 0xFFFF;
+		len = SPI_BB_HEADER_SIZE;
+	}
 
+	rawPackage->marker = PACKAGE_MARKER_V2;
+	rawPackage->ack = rx_expected;
+	rawPackage->ack_inv = ~rx_expected;
+	rawPackage->crc = SPI_BB_Crc(crc, package, 6);
 
+	SPI_DMA_Send(BB_SSP, package, len, NULL);			// the BB clocks at least as many bytes as the size in the header announces
+}
 
-#if 0 // nni original 2014-12-18 =>
 
-static void SPI_BB_PackageParser(uint8_t* buff, uint32_t len)
+// v2: checks the package, releases the acknowledged TX packages and returns 1 if the package is new and not empty
+static uint32_t SPI_BB_CheckPackageV2(uint8_t* buff, uint32_t received)
 {
-	uint32_t i;
-	uint16_t package_size;
-	uint32_t* package = (uint32_t*) buff;
-	uint16_t msg_type, msg_length;
-	uint32_t* msg_data;
+	raw_package_header_v2_t* rawPackage = (raw_package_header_v2_t *) buff;
+	uint32_t size = rawPackage->size_in_bytes;
 
-	if ((buff[0] & buff[3]) == 0xFF)
+	if ( ((uint8_t)(rawPackage->ack ^ rawPackage->ack_inv) != 0xFF) || ((size + sizeof(raw_package_header_v2_t)) > received) )
 	{
-		package_size = (package[0] & 0x00FFFF00) >> 8;
+		stats.crcErrors++;
+		return 0;
+	}
 
-		for (i = 1; i <= package_size; i++)
-		{
-			msg_type = (uint16_t) (package[i] >> 16);
-			msg_length = (uint16_t) (package[i] & 0xFFFF);
+	uint16_t crc = SPI_BB_Crc(0xFFFF, buff + sizeof(raw_package_header_v2_t), size);
 
-			if (msg_type == MSG_NOTIFICATION)
-			{
-				msg_data = NULL;
-			}
-			else
-			{
-				msg_data = package + i + 1;
-				i += msg_length;
-			}
+	if (SPI_BB_Crc(crc, buff, 6) != rawPackage->crc)
+	{
+		stats.crcErrors++;
+		return 0;
+	}
 
-			if (SPI_BB_MsgCb != NULL)
-			{
-				SPI_BB_MsgCb(msg_type, msg_length, msg_data);
-			}
+	if (link_v2 == 0)
+	{
+		uint32_t i;
+
+		for (i = tx_tail; i != tx_fill; i++)
+		{
+			tx_seq[i % SPI_BB_TX_NUM] = tx_seq_next++;		// packages closed in v1 get their sequence numbers now
 		}
+
+		link_v2 = 1;
 	}
 
-	//  when the parsing for the buffer is finished
+	while ( (tx_tail != tx_fill) && ((int8_t)(rawPackage->ack - tx_seq[tx_tail % SPI_BB_TX_NUM]) > 0) )
+	{
+#ifdef SPI_BB_BENCHMARK
+		SPI_BB_BenchLatency(tx_tail % SPI_BB_TX_NUM);
+		bench_tx_bytes += tx_size[tx_tail % SPI_BB_TX_NUM];
+#endif
+		tx_tail++;										// acknowledged
+	}
 
-	for (i = 0; i < SPI_BB_BUFFER_NUM; i++)
+	if ((int32_t)(tx_next - tx_tail) < 0)
 	{
-		if (buff == (uint8_t*)SPI_BB_Buffers[i])
-		{
-			SPI_BB_BufferState[i] = SPI_BB_BUFFER_FREE;
-			break;
-		}
+		tx_next = tx_tail;
 	}
-}
 
+	if (size == 0)
+	{
+		return 0;										// only an ACK
+	}
 
-#endif
+	int8_t dist = (int8_t)(rawPackage->seq - rx_expected);
 
-static void SPI_BB_InitTxBuff(void)
-{
-	uint8_t i;
-	raw_package_header_t* rawPackage;
+	if ( (dist < 0) && (dist >= -SEQ_WINDOW) )
+	{
+		stats.duplicates++;								// our ACK got lost, the next package repeats it
+		return 0;
+	}
 
-	for(i=0; i<2; i++) {
-		rawPackage = (raw_package_header_t *) tx_buff[i];
-		rawPackage->pre = rawPackage->post = PACKAGE_ENCLOSURE;
-		rawPackage->size_in_bytes = 0;
+	if ( (dist > 0) && (dist <= SEQ_WINDOW) )
+	{
+		stats.gaps++;									// a package before got lost, waiting for the retransmission
+		return 0;
 	}
 
-	tx_buff_offset = sizeof(raw_package_header_t);
+	rx_expected = rawPackage->seq + 1;					// in order, or a restart of the BB
+
+	rx_start[rx_dma] = sizeof(raw_package_header_v2_t);
+	rx_size[rx_dma] = size;
+
+	return 1;
 }
 
-static void SPI_BB_SendTxBuff(void)
+
+// handles a finished transfer with the number of bytes the BB has clocked
+// the package stays in its buffer until SPI_BB_ReleaseMessage has passed its last message
+static void SPI_BB_TransferDone(uint32_t received)
 {
-	raw_package_header_t* rawPackage = (raw_package_header_t *) tx_buff[tx_cur_buff];
+	uint8_t* buff = SPI_BB_Buffers[rx_dma];
+	uint32_t valid = 0;
 
-	rawPackage->size_in_bytes = tx_buff_offset - sizeof(raw_package_header_t);
-	rawPackage->pre = rawPackage->post = PACKAGE_ENCLOSURE;
-	SPI_DMA_Send(BB_SSP, tx_buff[tx_cur_buff], SPI_BB_BUFFER_SIZE, NULL);
-	if(tx_buff_offset == sizeof(raw_package_header_t))
-		tx_prq = 0;
-	else tx_prq = 1;
+	rx_active = 0;
 
-	tx_cur_buff = (tx_cur_buff + 1) % 2;
-	tx_buff_offset = sizeof(raw_package_header_t);
+	if ( (tx_sent_len > received) && ((int32_t)(tx_next - tx_sent) > 0) && ((int32_t)(tx_sent - tx_tail) >= 0) )
+	{
+		stats.truncated++;
+		tx_next = tx_sent;								// the BB has not clocked the whole package, it is sent again with the next transfer
+	}
 
-	rawPackage = (raw_package_header_t *) tx_buff[tx_cur_buff];
-	rawPackage->size_in_bytes = 0;
-}
+	tx_sent_len = 0;
 
+#ifdef SPI_BB_BENCHMARK
+	bench_transfers++;
+#endif
 
-static uint8_t* SPI_BB_RxBufferAvailable(void)
-{
-	uint8_t i;
-	for(i=0; i<SPI_BB_BUFFER_NUM; i++){
-		if(SPI_BB_BufferState[i] == SPI_BB_BUFFER_FREE)
-			return (uint8_t*)SPI_BB_Buffers[i];
+	if (received >= sizeof(raw_package_header_t))
+	{
+		if (buff[0] == PACKAGE_MARKER_V2)
+		{
+			valid = SPI_BB_CheckPackageV2(buff, received);
+		}
+		else
+		{
+			raw_package_header_t* rawPackage = (raw_package_header_t *) buff;
+
+			if ( (rawPackage->pre == PACKAGE_ENCLOSURE) && (rawPackage->post == PACKAGE_ENCLOSURE)
+			  && ((rawPackage->size_in_bytes + sizeof(raw_package_header_t)) <= received) )
+			{
+				link_v2 = 0;
+				rx_start[rx_dma] = sizeof(raw_package_header_t);
+				rx_size[rx_dma] = rawPackage->size_in_bytes;
+				valid = (rawPackage->size_in_bytes > 0);
+			}
+		}
 	}
-	return NULL;
+
+	if (valid == 0)
+	{
+		rx_size[rx_dma] = 0;								// empty or corrupt package, released by the parser to keep the order of the ring
+	}
+#ifdef SPI_BB_BENCHMARK
+	else
+	{
+		bench_rx_bytes += rx_size[rx_dma];
+	}
+#endif
+
+	SPI_BB_BufferState[rx_dma] = SPI_BB_BUFFER_FULL;
 }
 
 
+// the BB has clocked the whole buffer
 static void SPI_BB_ReceiveCallback(uint32_t ret)
 {
-	if(ret == SUCCESS)
-	{
-		SPI_BB_PackageParser(SPI_BB_CurrentBuffer, SPI_BB_BUFFER_SIZE);
-	}
+	SPI_BB_TransferDone((ret == SUCCESS) ? SPI_BB_BUFFER_SIZE : 0);
 }
 
 
@@ -236,14 +454,33 @@ void SPI_BB_Config(LPC_SSPn_Type *SSPx, SPI_BB_PINS_T* bb_pins)
 
 /**********************************************************************
  * @brief		Initializes the SPI-BB communication
- * @param[in]	msg_cb	Pointer to the MessageCallback function
  **********************************************************************/
 
-void SPI_BB_Init(MessageCallback msg_cb)
+void SPI_BB_Init(void)
 {
-	SPI_BB_MsgCb = msg_cb;
-	SPI_BB_InitTxBuff();
-	SPI_DMA_Init(BB_SSP, SSP_SLAVE_MODE, 100000);
+	uint32_t i;
+
+	for (i = 0; i < SPI_BB_BUFFER_NUM; i++)
+	{
+		SPI_BB_BufferState[i] = SPI_BB_BUFFER_FREE;
+	}
+
+	rx_head = 0;
+	rx_tail = 0;
+	rx_pos = 0;
+	rx_expected = 0;
+
+	tx_fill = 0;
+	tx_next = 0;
+	tx_tail = 0;
+	tx_buff_offset = SPI_BB_HEADER_SIZE;
+	tx_seq_next = 0;
+	tx_sent_len = 0;
+
+	rx_active = 0;
+	link_v2 = 0;
+
+	SPI_DMA_Init(BB_SSP, SSP_SLAVE_MODE, 100000);		// slave: the clock comes from the BB, the rate only sets the prescaler
 }
 
 
@@ -254,7 +491,9 @@ void SPI_BB_Init(MessageCallback msg_cb)
 void SPI_BB_Polling(void)
 {
 	uint8_t* rcv_buff;
-	uint8_t i;
+	uint32_t pending;
+
+	tick++;
 
 	if(SPI_BB_CheckGpOUT(pins->heartbeat)) {
 		NL_GPIO_Clr(pins->heartbeat);
@@ -263,62 +502,227 @@ void SPI_BB_Polling(void)
 		NL_GPIO_Set(pins->heartbeat);
 	}
 
-	if((tx_prq || (tx_buff_offset > sizeof(raw_package_header_t))) && !SPI_BB_CheckGpOUT(pins->prq))
+#ifdef SPI_BB_BENCHMARK
+	if ((tick - bench_start) >= SPI_BB_BENCH_TICKS)
+	{
+		bench.txBytesPerSec = bench_tx_bytes;
+		bench.rxBytesPerSec = bench_rx_bytes;
+		bench.transfersPerSec = bench_transfers;
+		bench.avgLatencyUs = bench_latency_num ? (bench_latency_sum * 125) / bench_latency_num : 0;
+		bench.maxLatencyUs = bench_latency_max * 125;
+
+		bench_tx_bytes = 0;
+		bench_rx_bytes = 0;
+		bench_transfers = 0;
+		bench_latency_sum = 0;
+		bench_latency_num = 0;
+		bench_latency_max = 0;
+		bench_start = tick;
+	}
+#endif
+
+	pending = (tx_buff_offset > SPI_BB_HEADER_SIZE) || (tx_tail != tx_fill);		// new messages, packages waiting to be sent or without ACK
+
+	if(pending && !SPI_BB_CheckGpOUT(pins->prq))
 		NL_GPIO_Set(pins->prq);
-	else if(!(tx_prq || (tx_buff_offset > sizeof(raw_package_header_t))) && SPI_BB_CheckGpOUT(pins->prq))
+	else if(!pending && SPI_BB_CheckGpOUT(pins->prq))
 		NL_GPIO_Clr(pins->prq);
 
-	/** @todo recovery in case CS-low but no SPI-transfer */
 	/* Chip select went down? */
-	if(!SPI_BB_CheckGpIN(pins->cs) && SPI_BB_CheckGpOUT(pins->rdy))
-		NL_GPIO_Clr(pins->rdy);
-	else if(SPI_BB_CheckGpIN(pins->cs) && !SPI_BB_CheckGpOUT(pins->rdy)){
-		/* Chip select went up? */
-		rcv_buff = SPI_BB_RxBufferAvailable();
-		if(rcv_buff) {
-			if(SPI_DMA_Receive(BB_SSP, rcv_buff, SPI_BB_BUFFER_SIZE,
-					(TransferCallback)SPI_BB_ReceiveCallback)) {
-				//*********************************
-				SPI_BB_SendTxBuff();
-
-				SPI_BB_CurrentBuffer = rcv_buff;
-				NL_GPIO_Set(pins->rdy);
-				for(i=0; i<SPI_BB_BUFFER_NUM; i++)
-					if(rcv_buff == (uint8_t*)SPI_BB_Buffers[i]){
-						SPI_BB_BufferState[i] = SPI_BB_BUFFER_BUSY;					/// Suche nicht nötig !!!
-						break;
-					}
+	if(!SPI_BB_CheckGpIN(pins->cs)) {
+		if(SPI_BB_CheckGpOUT(pins->rdy))
+			NL_GPIO_Clr(pins->rdy);
+		return;
+	}
+
+	/* Chip select is up */
+	if(rx_active) {
+		/* a short transfer can start and end between two ticks, then RDY is still set */
+		if(!SPI_BB_CheckGpOUT(pins->rdy) || SPI_DMA_RxStarted(BB_SSP, SPI_BB_BUFFER_SIZE)) {
+			NL_GPIO_Clr(pins->rdy);						// re-armed with the next tick, the BB waits for the rising edge
+			if(!SPI_BB_CheckGpIN(pins->cs))
+				return;									// a transfer has started before RDY went down, it ends with the next rising CS
+			/* the BB has ended the transfer before the end of the buffer */
+			SPI_BB_TransferDone(SPI_DMA_Abort(BB_SSP, SPI_BB_Buffers[rx_dma], SPI_BB_BUFFER_SIZE));
+		}
+		return;
+	}
+
+	if(SPI_BB_CheckGpOUT(pins->rdy)) {
+		NL_GPIO_Clr(pins->rdy);							// the transfer was finished by the DMA callback
+		return;
+	}
+
+	while ( (SPI_BB_BufferState[rx_tail] == SPI_BB_BUFFER_FULL) && (rx_size[rx_tail] == 0) ) {
+		SPI_BB_BufferState[rx_tail] = SPI_BB_BUFFER_FREE;	// empty packages at the tail don't have to wait for the parser
+		rx_tail = (rx_tail + 1) % SPI_BB_BUFFER_NUM;
+		rx_pos = 0;
+	}
+	if(SPI_BB_BufferState[rx_head] == SPI_BB_BUFFER_FREE) {		// otherwise the BB has to wait until the parser has released a buffer
+		rcv_buff = SPI_BB_Buffers[rx_head];
+		if(SPI_DMA_Receive(BB_SSP, rcv_buff, SPI_BB_BUFFER_SIZE,
+				(TransferCallback)SPI_BB_ReceiveCallback)) {
+			//*********************************
+			SPI_BB_SendTxBuff();
+
+			SPI_BB_BufferState[rx_head] = SPI_BB_BUFFER_BUSY;
+			rx_dma = rx_head;
+			rx_head = (rx_head + 1) % SPI_BB_BUFFER_NUM;
+			rx_active = 1;
+			NL_GPIO_Set(pins->rdy);
+		}
+	}
+}
+
+
+/**********************************************************************
+ * @brief		Returns the oldest received message, which is not released yet.
+ * 				The values stay in the receive buffer until the message is released.
+ * @param[out]	type	message type
+ * @param[out]	length	number of values
+ * @return		pointer to the values, NULL if there is no message
+ **********************************************************************/
+
+uint16_t* SPI_BB_PeekMessage(uint16_t* type, uint16_t* length)
+{
+	while (SPI_BB_BufferState[rx_tail] == SPI_BB_BUFFER_FULL)
+	{
+		if (rx_pos + sizeof(msg_header_t) <= rx_size[rx_tail])
+		{
+			msg_t* msg = (msg_t*) (SPI_BB_Buffers[rx_tail] + rx_start[rx_tail] + rx_pos);
+
+			if (rx_pos + sizeof(msg_header_t) + sizeof(uint16_t) * msg->header.length <= rx_size[rx_tail])
+			{
+				*type = msg->header.type;
+				*length = msg->header.length;
+
+				return (uint16_t*) ((uint8_t*) msg + sizeof(msg_header_t));
 			}
 		}
+
+		SPI_BB_BufferState[rx_tail] = SPI_BB_BUFFER_FREE;		// package finished (or empty, or truncated message): handing the buffer back to the DMA
+		rx_tail = (rx_tail + 1) % SPI_BB_BUFFER_NUM;
+		rx_pos = 0;
 	}
 
+	return NULL;
 }
 
 
 /**********************************************************************
- * @param[in]	buff	Pointer to the buffer
- * @param[in]	len		Length of the buffer
- * @return		len - Success; 0 - failure
+ * @brief		Releases the message returned by SPI_BB_PeekMessage
  **********************************************************************/
 
-uint32_t SPI_BB_Send(uint8_t* buff, uint32_t len)
+void SPI_BB_ReleaseMessage(void)
 {
-	uint32_t i;
+	if (SPI_BB_BufferState[rx_tail] == SPI_BB_BUFFER_FULL)
+	{
+		msg_t* msg = (msg_t*) (SPI_BB_Buffers[rx_tail] + rx_start[rx_tail] + rx_pos);
 
-	if ((tx_buff_offset + len) >= SPI_BB_BUFFER_SIZE)
+		rx_pos += sizeof(msg_header_t) + sizeof(uint16_t) * msg->header.length;
+	}
+}
+
+
+/**********************************************************************
+ * @brief		Reserves a message in the current TX package and writes its header.
+ * 				A full package is closed and the message goes into the next one,
+ * 				so several packages can be sent during one PRQ.
+ * @param[in]	type	message type
+ * @param[in]	length	number of values, written by the caller into the returned buffer
+ * @return		pointer to the values, NULL if all packages are full
+ **********************************************************************/
+
+uint16_t* SPI_BB_ReserveMessage(uint16_t type, uint16_t length)
+{
+	uint32_t size = sizeof(msg_header_t) + sizeof(uint16_t) * length;
+
+	if ((tx_buff_offset + size) > SPI_BB_BUFFER_SIZE)
 	{
-		return 0;
+		if ( (tx_buff_offset == SPI_BB_HEADER_SIZE) || ((tx_fill - tx_tail) >= (SPI_BB_TX_NUM - 1)) )
+		{
+			return NULL;								// message too long, or no free package
+		}
+
+		SPI_BB_ClosePackage();
+
+		if ((tx_buff_offset + size) > SPI_BB_BUFFER_SIZE)
+		{
+			return NULL;
+		}
 	}
 
-	for (i = 0; i < len; i++)
+	msg_t* msg = (msg_t*) (tx_buff[tx_fill % SPI_BB_TX_NUM] + tx_buff_offset);
+
+	msg->header.type = type;
+	msg->header.length = length;
+
+	tx_buff_offset += size;
+
+	return (uint16_t*) ((uint8_t*) msg + sizeof(msg_header_t));
+}
+
+
+/**********************************************************************
+ * @return		number of values that fit into the current TX package
+ * 				behind the header of a further message, or into the next
+ * 				package if it can be opened
+ **********************************************************************/
+
+uint32_t SPI_BB_TxSpace(void)
+{
+	uint32_t used = tx_buff_offset + sizeof(msg_header_t);
+
+	if ( (used + sizeof(uint16_t) > SPI_BB_BUFFER_SIZE) && ((tx_fill - tx_tail) < (SPI_BB_TX_NUM - 1)) )
 	{
-		tx_buff[tx_cur_buff][tx_buff_offset++] = buff[i];
+		used = SPI_BB_HEADER_SIZE + sizeof(msg_header_t);
 	}
 
-	return len;
+	return (used < SPI_BB_BUFFER_SIZE) ? (SPI_BB_BUFFER_SIZE - used) / sizeof(uint16_t) : 0;
 }
 
 
+/**********************************************************************
+ * @return		bytes waiting in the current TX package and in the closed
+ * 				packages which have not been sent yet
+ **********************************************************************/
+
+uint32_t SPI_BB_TxPending(void)
+{
+	uint32_t pending = tx_buff_offset - SPI_BB_HEADER_SIZE;
+	uint32_t i;
+
+	for (i = tx_next; i != tx_fill; i++)
+	{
+		pending += tx_size[i % SPI_BB_TX_NUM];
+	}
+
+	return pending;
+}
+
+
+/**********************************************************************
+ * @return		error and retransmission counters of the v2 protocol
+ **********************************************************************/
+
+const SPI_BB_STATS_T* SPI_BB_GetStats(void)
+{
+	return &stats;
+}
+
+
+#ifdef SPI_BB_BENCHMARK
+/**********************************************************************
+ * @return		throughput and ACK latency of the last second
+ **********************************************************************/
+
+const SPI_BB_BENCH_RESULT_T* SPI_BB_GetBenchmark(void)
+{
+	return &bench;
+}
+#endif
+
+
 /******************************************************************************/
 /**	param[in]	state of prq, cs, heartbeat, rdy
 				-  0: gpios off
@@ -21,10 +21,30 @@
 
 #define	SPI_BB_DMA_SEND_CHAN	2
 #define SPI_BB_BUFFER_SIZE		1024
-#define SPI_BB_BUFFER_NUM		2
+#define SPI_BB_BUFFER_NUM		4			// rx ring
+#define SPI_BB_TX_NUM			4			// tx ring: the package being filled + up to 3 packages waiting for their ACK (v2)
 
 #define SPI_BB_BUFFER_FREE		0
-#define SPI_BB_BUFFER_BUSY		1
+#define SPI_BB_BUFFER_BUSY		1			// receiving
+#define SPI_BB_BUFFER_FULL		2			// received, waiting for the parser
+
+typedef struct {
+	uint32_t crcErrors;			// v2 packages with a corrupt header or CRC
+	uint32_t duplicates;		// v2 packages received twice (lost ACK)
+	uint32_t gaps;				// v2 packages discarded behind a lost one
+	uint32_t retransmits;		// packages sent again because of a missing ACK
+	uint32_t truncated;			// v2 packages sent again because the BB ended the transfer before their end
+} SPI_BB_STATS_T;
+
+#ifdef SPI_BB_BENCHMARK
+typedef struct {
+	uint32_t txBytesPerSec;		// payload delivered to the BB (v2: acknowledged)
+	uint32_t rxBytesPerSec;		// payload received from the BB
+	uint32_t transfersPerSec;
+	uint32_t avgLatencyUs;		// closing a package -> ACK (v1: -> sending)
+	uint32_t maxLatencyUs;
+} SPI_BB_BENCH_RESULT_T;
+#endif
 
 typedef struct {
 	GPIO_NAME_T* cs;
@@ -33,12 +53,22 @@ typedef struct {
 	GPIO_NAME_T* prq;
 } SPI_BB_PINS_T;
 
-typedef void (*MessageCallback)(uint16_t type, uint16_t length, uint16_t* data);
-
-void SPI_BB_Init(MessageCallback msg_cb);
+void SPI_BB_Init(void);
 void SPI_BB_Config(LPC_SSPn_Type *SSPx, SPI_BB_PINS_T* bb_pins);
 void SPI_BB_Polling(void);
-uint32_t SPI_BB_Send(uint8_t* buff, uint32_t len);		/// ssc: we need an implementation on message level
+
+uint16_t* SPI_BB_PeekMessage(uint16_t* type, uint16_t* length);
+void SPI_BB_ReleaseMessage(void);
+
+uint16_t* SPI_BB_ReserveMessage(uint16_t type, uint16_t length);
+uint32_t SPI_BB_TxSpace(void);
+uint32_t SPI_BB_TxPending(void);
+
+const SPI_BB_STATS_T* SPI_BB_GetStats(void);
+#ifdef SPI_BB_BENCHMARK
+const SPI_BB_BENCH_RESULT_T* SPI_BB_GetBenchmark(void);
+#endif
+
 void SPI_BB_TestGpios(uint8_t state);
 
 #endif /* NL_SPI_BB_H_ */
@@ -5,9 +5,8 @@
  *      Author: ssc
  */
 
-#include "math.h"
-
 #include "nl_tcd_adc_work.h"
+#include "nl_tcd_tables.h"
 #include "espi/dev/nl_espi_dev_pedals.h"
 #include "ipc/emphase_ipc.h"
 
@@ -50,7 +49,18 @@
 #define HW_SOURCE_ID_RIBBON_2	7
 
 
+#define HW_SEND_FAST			2		// runs of ADC_WORK_SendBBMessages (10 ms) between two sendings while a control is moving
+#define HW_SEND_IDLE			10		// ... while all controls are still
+#define HW_MOVING_TIMEOUT		25		// 250 ms without a change: back to the idle rate
+#define HW_SEND_HYSTERESIS		8		// smaller changes don't count as a movement, they are sent at the idle rate
+
+
 static uint32_t bbSendValue[NUM_HW_SOURCES] = {};
+static uint32_t bbLastSent[NUM_HW_SOURCES] = {};
+
+static uint32_t hwSendCountdown = 0;
+static uint32_t hwMovingTimer = 0;			// > 0: a control has been moved recently
+static uint32_t hwPackedMessages = 0;		// 1: all changed sources in one BB_MSG_TYPE_HW_SOURCES message
 
 static uint32_t hwParamId[NUM_HW_SOURCES] =
 				{	PARAM_ID_PEDAL_1,
@@ -114,10 +124,10 @@ static uint32_t pbTestMode;
 static uint32_t pbRampMode;
 static int32_t pbRamp;
 static int32_t pbRampInc;
-static uint32_t benderTable[33] = {};				// contains the chosen aftertouch curve
+static const uint32_t* benderTable = BENDER_TABLE[1];	// points to the chosen bender curve
 
 static uint32_t lastAftertouch;
-static uint32_t atTable[33] = {};				// contains the chosen aftertouch curve
+static const uint32_t* atTable = AT_TABLE[1];			// points to the chosen aftertouch curve
 
 static uint32_t lastRibbon1;
 static uint32_t ribbon1Touch;
@@ -145,82 +155,42 @@ static uint32_t suspend;
 
 
 /*****************************************************************************
-* @brief	ADC_WORK_Generate_BenderTable -
-* @param	0: soft, 1: normal, 2: hard
+* @brief	ADC_WORK_Select_BenderTable -
+* @param	0: soft (y = x), 1: normal (y = 0.5 * x + 0.5 * x^3), 2: hard (y = x^3)
+*			the tables are generated at build time (nl_tcd_tables.c)
 ******************************************************************************/
 
-void ADC_WORK_Generate_BenderTable(uint32_t curve)
+void ADC_WORK_Select_BenderTable(uint32_t curve)
 {
-	float_t range = 8000.0;		// separate processing of absolute values for positive and negative range
-
-	float_t s = 0.5;
-
-	switch (curve)	// s defines the curve shape
+	if (curve < NUM_HW_CURVES)
 	{
-		case 0:		// soft
-			s = 0.0;			// y = x
-			break;
-		case 1:		// normal
-			s = 0.5;			// y = 0.5 * x + 0.5 * x^3
-			break;
-		case 2:		// hard
-			s = 1.0;			// y = x^3
-			break;
-		default:
-			/// Error
-			break;
+		benderTable = BENDER_TABLE[curve];
 	}
-
-	uint32_t i_max = 32;
-	uint32_t i;
-	float x;
-
-	for (i = 0; i <= i_max; i++)
+	else
 	{
-		x = (float)i / (float)i_max;
-
-		benderTable[i] = (uint32_t)( range * x * ((1.0 - s) + s * x*x ) );
+		benderTable = BENDER_TABLE[1];
+		/// Error
 	}
 }
 
 
 
 /*****************************************************************************
-* @brief	ADC_WORK_Generate_AftertouchTable -
-* @param	0: soft, 1: normal, 2: hard
+* @brief	ADC_WORK_Select_AftertouchTable -
+* @param	0: soft (y = x), 1: normal (y = 0.3 * x + 0.7 * x^6), 2: hard (y = 0.05 * x + 0.95 * x^6)
+*			the tables are generated at build time (nl_tcd_tables.c)
 ******************************************************************************/
 
-void ADC_WORK_Generate_AftertouchTable(uint32_t curve)
+void ADC_WORK_Select_AftertouchTable(uint32_t curve)
 {
-	float_t range = 16000.0;	// full TCD range
-
-	float_t s = 0.7;
-
-	switch (curve)	// s defines the curve shape
+	if (curve < NUM_HW_CURVES)
 	{
-		case 0:		// soft
-			s = 0.0;			// y = x
-			break;
-		case 1:		// normal
-			s = 0.7;			// y = 0.3 * x + 0.7 * x^6
-			break;
-		case 2:		// hard
-			s = 0.95;			// y = 0.05 * x + 0.95 * x^6
-			break;
-		default:
-			/// Error
-			break;
+		atTable = AT_TABLE[curve];
 	}
-
-	uint32_t i_max = 32;
-	uint32_t i;
-	float x;
-
-	for (i = 0; i <= i_max; i++)
+	else
 	{
-		x = (float)i / (float)i_max;
-
-		atTable[i] = (uint32_t)( range * x * ((1.0 - s) + s * x*x*x*x*x ) );
+		atTable = AT_TABLE[1];
+		/// Error
 	}
 }
 
@@ -287,10 +257,10 @@ void ADC_WORK_Init(void)
 	pbRampMode = 0;
 	pbRamp = 0;
 	pbRampInc = 0;
-	ADC_WORK_Generate_BenderTable(1);
+	ADC_WORK_Select_BenderTable(1);
 
 	lastAftertouch = 0;
-	ADC_WORK_Generate_AftertouchTable(1);
+	ADC_WORK_Select_AftertouchTable(1);
 
 	lastRibbon1 = 0;
 	ribbon1Touch = 0;
@@ -563,31 +533,135 @@ void WriteHWValueForBB(uint32_t hwSourceId, uint32_t value)
 }
 
 
-void ADC_WORK_SendBBMessages(void)					// is called as a regular COOS task
+/*****************************************************************************
+* @brief	IsMovement - a change counts as a movement, if it is larger than
+* 			the hysteresis or reaches an end or the center of the range
+******************************************************************************/
+
+static uint32_t IsMovement(uint32_t hwSourceId, uint32_t value)
+{
+	uint32_t last = bbLastSent[hwSourceId];
+
+	if ( (value == 0) || (value == 8000) || (value == 16000) )
+	{
+		return (value != last);
+	}
+
+	return ( (value >= last + HW_SEND_HYSTERESIS) || (last >= value + HW_SEND_HYSTERESIS) );
+}
+
+
+
+/*****************************************************************************
+* @brief	ADC_WORK_SendBBMessages - sends the changed hardware sources to
+* 			the BB, every 20 ms while a control is moving, every 100 ms
+* 			otherwise. The first movement after a still phase is sent at once.
+* 			COOS task, every 10 ms
+******************************************************************************/
+
+void ADC_WORK_SendBBMessages(void)
 {
 	uint32_t i;
+	uint32_t moved = 0;
 	uint32_t send = 0;
 
 	for (i = 0; i < NUM_HW_SOURCES; i++)
 	{
-		if (bbSendValue[i] > 0)
+		if ( (bbSendValue[i] > 0) && IsMovement(i, bbSendValue[i] & 0xFFFF) )
+		{
+			moved = 1;
+		}
+	}
+
+	if (moved)
+	{
+		if (hwMovingTimer == 0)
 		{
-			if (BB_MSG_WriteMessage2Arg(BB_MSG_TYPE_PARAMETER, hwParamId[i], (bbSendValue[i] & 0xFFFF)) > -1)
+			hwSendCountdown = 0;
+		}
+
+		hwMovingTimer = HW_MOVING_TIMEOUT;
+	}
+	else if (hwMovingTimer > 0)
+	{
+		hwMovingTimer--;
+	}
+
+	if (hwSendCountdown > 0)
+	{
+		hwSendCountdown--;
+		return;
+	}
+
+	hwSendCountdown = (hwMovingTimer > 0) ? HW_SEND_FAST - 1 : HW_SEND_IDLE - 1;
+
+	if (hwPackedMessages)
+	{
+		uint16_t data[1 + NUM_HW_SOURCES];				// bitmap of the sources, followed by their values
+		uint32_t n = 1;
+
+		data[0] = 0;
+
+		for (i = 0; i < NUM_HW_SOURCES; i++)
+		{
+			if (bbSendValue[i] > 0)
 			{
-				bbSendValue[i] = 0;
-				send = 1;
+				data[0] |= 1 << i;
+				data[n] = bbSendValue[i] & 0xFFFF;
+				n++;
+			}
+		}
+
+		if ( (n > 1) && (BB_MSG_WriteMessage(BB_MSG_TYPE_HW_SOURCES, n, data) > -1) )
+		{
+			for (i = 0; i < NUM_HW_SOURCES; i++)
+			{
+				if (bbSendValue[i] > 0)
+				{
+					bbLastSent[i] = bbSendValue[i] & 0xFFFF;
+					bbSendValue[i] = 0;
+				}
+			}
+
+			send = 1;
+		}
+	}
+	else
+	{
+		for (i = 0; i < NUM_HW_SOURCES; i++)
+		{
+			if (bbSendValue[i] > 0)
+			{
+				if (BB_MSG_WriteMessage2Arg(BB_MSG_TYPE_PARAMETER, hwParamId[i], (bbSendValue[i] & 0xFFFF)) > -1)
+				{
+					bbLastSent[i] = bbSendValue[i] & 0xFFFF;
+					bbSendValue[i] = 0;
+					send = 1;
+				}
 			}
 		}
 	}
 
 	if (send == 1)
 	{
-		BB_MSG_SendTheBuffer();			/// später mit somethingToSend = 1; !!!
+		BB_MSG_SendTheBuffer();
 	}
 }
 
 
 
+/*****************************************************************************
+* @brief	ADC_WORK_SetPackedHWMessages - 0: a PARAMETER message per source,
+* 			1: one HW_SOURCES message with all changed sources
+******************************************************************************/
+
+void ADC_WORK_SetPackedHWMessages(uint32_t packed)
+{
+	hwPackedMessages = (packed != 0);
+}
+
+
+
 /*****************************************************************************
 * @brief	LinearizeRibbon -
 ******************************************************************************/
@@ -26,6 +26,7 @@ void ADC_WORK_Suspend(void);
 void ADC_WORK_Resume(void);
 
 void ADC_WORK_SendBBMessages(void);
+void ADC_WORK_SetPackedHWMessages(uint32_t packed);
 
 void ADC_WORK_SetPedal1Behaviour(uint32_t behaviour);
 void ADC_WORK_SetPedal2Behaviour(uint32_t behaviour);
@@ -48,7 +49,7 @@ uint32_t ADC_WORK_GetRibbon2Behaviour(void);
 void ADC_WORK_Check_Pedal_Start(uint32_t pedalId);
 void ADC_WORK_Check_Pedal_Cancel(uint32_t pedalId);
 
-void ADC_WORK_Generate_BenderTable(uint32_t curve);
-void ADC_WORK_Generate_AftertouchTable(uint32_t curve);
+void ADC_WORK_Select_BenderTable(uint32_t curve);
+void ADC_WORK_Select_AftertouchTable(uint32_t curve);
 
 #endif /* TCD_NL_TCD_ADC_WORK_H_ */
@@ -5,12 +5,15 @@
  *      Author: ssc
  */
 
-#include "math.h"
-
 #include "nl_tcd_expon.h"
+#include "nl_tcd_tables.h"
+
+#if defined(EXPON_BENCHMARK) && defined(CORE_M4)
+#include "cmsis/LPC43xx.h"
+#endif
 
 
-static uint32_t expTime[126];
+static const uint32_t* const expTime = EXPON_TABLE;		// generated at build time, see nl_tcd_tables.h
 
 
 // Der (exponentielle) Bereich von 104.0823997 dB (1 : 160000) wird auf eine (lineare) Skala von 0 ...16000 verteilt
@@ -19,53 +22,82 @@ static uint32_t expTime[126];
 // Für den Bereich (60 dB_T) der Attack/Release-Velocity: 9223.46
 
 
-// Exp-Näherung durch eine Tabellen mit 126 Einträgen (125 Segmente für lineare Interpolation)
-// ungefährer maximaler Fehler: 0.0012  = 1.2 promille
-
-
-void EXPON_Init(void)
-{
-	float in;
-	float time_ms;
-
-	float logMin = log(0.1);			// range limits [in ms] for Attack times
-	float logMax = log(16000);
-	float logDiff = logMax - logMin;
-
-	expTime[0] = 0;
-
-	uint32_t i;
-
-	for (i = 1; i < 126; i++)
-	{
-		in = (float)i / 125.0;
-		time_ms = exp(logMin + in * logDiff);
-
-		expTime[i] = (uint32_t)(time_ms / TIME_UNIT_MS + 0.5);
-	}
-}
+// Exp-Näherung durch eine Tabelle mit EXPON_SEGMENTS Segmenten für lineare Interpolation,
+// die Segmentbreite (1 << EXPON_SEGMENT_SHIFT) wird beim Build gewählt (nl_tcd_tables.h)
+// ungefährer maximaler Fehler (gen_tcd_tables -r):
+//   EXPON_SEGMENT_SHIFT 4: 1000 Segmente, 4 kB,   33 ppm
+//   EXPON_SEGMENT_SHIFT 5:  500 Segmente, 2 kB,   83 ppm
+//   EXPON_SEGMENT_SHIFT 6:  250 Segmente, 1 kB,  298 ppm
+//   EXPON_SEGMENT_SHIFT 7:  125 Segmente, 0.5 kB, 1.2 promille (bisherige Tabelle)
+// die Tabellenwerte sind mit 2^EXPON_FRACT_BITS skaliert, gerundet wird erst am Ausgang
 
 
 uint32_t EXPON_Time(int32_t paramVal)		// input range: 0 ... 16000; output range: 0.1 ... 16000 ms as a multiple of TIME_UNIT_MS
 {
 	if (paramVal <= 0)							// we can handle only positive values
 	{
-		return expTime[0];
+		return 0;
 	}
 	else if (paramVal < 160)					// linear segment between 0.00 and 0.01
 	{
-		// return (uint32_t)(paramVal * (1.0 / 160.0) * expTime[1] + 0.5);  // (...) = 0.0339034
-		return ((paramVal * expTime[1] * 13) >> 11);
+		return (paramVal * EXPON_LIN_SLOPE + (1 << (EXPON_FRACT_BITS + 15))) >> (EXPON_FRACT_BITS + 16);
 	}
-	else if (paramVal >= 16000)					// 16000 = 125 * 128
+	else if (paramVal >= 16000)
 	{
-		return expTime[125];
+		return (expTime[EXPON_SEGMENTS] + (1 << (EXPON_FRACT_BITS - 1))) >> EXPON_FRACT_BITS;
 	}
 	else
 	{
-		uint32_t index = paramVal >> 7;  			// dividing by 128
-		uint32_t fract = paramVal & 0x7f;			// 0...127
+		uint32_t index = paramVal >> EXPON_SEGMENT_SHIFT;
+		uint32_t fract = paramVal & ((1 << EXPON_SEGMENT_SHIFT) - 1);
+
+		uint32_t t = expTime[index] + (uint32_t)(((uint64_t)(expTime[index + 1] - expTime[index]) * fract) >> EXPON_SEGMENT_SHIFT);	// linear interpolation, UMULL on the M4
 
-		return ((expTime[index] * (128 - fract) + expTime[index + 1] * fract) >> 7);	// linear interpolation for the lower 7 bits
+		return (t + (1 << (EXPON_FRACT_BITS - 1))) >> EXPON_FRACT_BITS;
 	}
 }
+
+
+
+#if defined(EXPON_BENCHMARK) && defined(CORE_M4)
+
+/*****************************************************************************
+* @brief	EXPON_Benchmark - measures the cycles of EXPON_Time() over the full
+*			input range with the DWT cycle counter of the M4
+*			the accuracy of the segment widths is reported by gen_tcd_tables -r
+* @param	result: average and maximum cycles per call, checksum of all outputs
+******************************************************************************/
+
+void EXPON_Benchmark(EXPON_BENCH_RESULT_T* result)
+{
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t sum = 0;
+	uint32_t max = 0;
+	uint32_t check = 0;
+	int32_t paramVal;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for (paramVal = 0; paramVal <= 16000; paramVal++)
+	{
+		start = DWT->CYCCNT;
+		check += EXPON_Time(paramVal);
+		cycles = DWT->CYCCNT - start;
+
+		sum += cycles;
+
+		if (cycles > max)
+		{
+			max = cycles;
+		}
+	}
+
+	result->segments = EXPON_SEGMENTS;
+	result->avgCycles = sum / 16001;
+	result->maxCycles = max;
+	result->checksum = check;
+}
+
+#endif
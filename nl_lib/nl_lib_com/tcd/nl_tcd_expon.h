@@ -12,8 +12,20 @@
 
 #define TIME_UNIT_MS  0.0208333  // a sample period of 48 kHz [in ms]
 
-void EXPON_Init(void);
-
 uint32_t EXPON_Time(int32_t paramVal);
 
+
+#if defined(EXPON_BENCHMARK) && defined(CORE_M4)
+
+typedef struct {
+	uint32_t segments;
+	uint32_t avgCycles;				// per call of EXPON_Time(), including the cycle counter reads
+	uint32_t maxCycles;
+	uint32_t checksum;				// sum of all outputs, keeps the calls from being optimized away
+} EXPON_BENCH_RESULT_T;
+
+void EXPON_Benchmark(EXPON_BENCH_RESULT_T* result);
+
+#endif
+
 #endif /* NL_TCD_NL_TCD_EXPON_H_ */
@@ -10,9 +10,12 @@
 
 #include "nl_tcd_msg.h"
 
+#include "cmsis/LPC43xx.h"
+#include "drv/nl_cgu.h"
 #include "sys/nl_coos.h"
 
 #include "usb/nl_usb_midi.h"
+#include "usb/nl_usb_midi_parser.h"
 #include "drv/nl_dbg.h"
 
 #include "nl_tcd_valloc.h"
@@ -22,8 +25,9 @@
 /*	modul local defines														  */
 /******************************************************************************/
 
-#define BUFFER_SIZE 512
-
+#define PEND_P			0x01								// compact format: messages waiting for a partner
+#define PEND_KV			0x02
+#define PEND_PITCH		0x04
 
 /******************************************************************************/
 /*	modul local variables													  */
@@ -32,12 +36,25 @@
 static int32_t	oldParameter = -1;
 static int32_t	multipleParams = 0;
 
-static uint8_t	buff[2][BUFFER_SIZE] = {};					// Two buffers for MIDI sending, alternately used
-static uint32_t buf = 0;									// Counts the used bytes of the bulk buffer
+static uint8_t midiUSBConfigured = 0;
 
-static uint32_t writeBuffer = 0;
+static uint32_t lastDropped = 0;							// dropped bytes of the USB-MIDI TX ring at the last check
 
-static uint8_t midiUSBConfigured = 0;
+static uint32_t wireFormat = MSG_FORMAT_MIDI;
+static uint32_t pending = 0;								// PEND_... flags
+static uint32_t pendP;
+static uint32_t pendKeyVoice;
+static uint32_t pendPitch;									// absolute value
+static uint32_t pendPitchSign;								// 0x40: negative
+static uint32_t lastP = 0x3FFF;								// Id of the last P message, reference of the combined messages
+
+static uint32_t lastCycles = 0;								// MSG_GetTime()
+static uint32_t restCycles = 0;
+static uint32_t timeUs = 0;
+static uint32_t eventTime;									// time of the following KD, KU and D messages
+static uint32_t eventTimeValid = 0;							// 0: the time of the next of them is taken
+static uint32_t stampTime;									// time of the last MSG_TIMESTAMP
+static uint32_t stampValid = 0;
 
 
 /******************************************************************************/
@@ -47,6 +64,8 @@ static uint8_t midiUSBConfigured = 0;
 
 void MSG_CheckUSB(void)			// every 200 ms
 {
+	MSG_GetTime();											// at least once per wrap of the cycle counter
+
     if (USB_MIDI_IsConfigured())
     {
 	    if (midiUSBConfigured == 0)
@@ -63,6 +82,9 @@ void MSG_CheckUSB(void)			// every 200 ms
 		{
 			// DBG_Led_Usb_On();
 			USB_MIDI_DropMessages(1);
+			pending = 0;
+			wireFormat = MSG_FORMAT_MIDI;						// the ePC negotiates again after reconnecting
+			stampValid = 0;
 		}
 
 		midiUSBConfigured = 0;
@@ -71,29 +93,230 @@ void MSG_CheckUSB(void)			// every 200 ms
 
 
 /******************************************************************************/
-/**	@brief  SendMidiBuffer - sends the USB bulk
+/**	@brief  WriteMidi - writes a 4-byte USB-MIDI event into the TX ring of the
+ * 			USB-MIDI driver, a full slot of the ring is sent automatically
 *******************************************************************************/
 
-void MSG_SendMidiBuffer(void)
+static void WriteMidi(uint8_t cin, uint8_t status, uint8_t data1, uint8_t data2)
 {
-	if (buf)											// Anything to send
+	uint8_t* event = USB_MIDI_Reserve(4);
+
+	if (event)												// NULL: USB not configured, or the ring is full (counted by the driver)
 	{
-#if 0
-		if (USB_MIDI_Send(buff[writeBuffer], buf, 1) )	// Sending of the current writeBuffer and checking for success
-#endif
+		event[0] = cin;
+		event[1] = status;
+		event[2] = data1;
+		event[3] = data2;
+	}
+}
 
-		if ( (USB_MIDI_BytesToSend() == 0) 					// Last transfer has finished
-		  && (USB_MIDI_Send(buff[writeBuffer], buf, 0)) )	// Sending of the current writeBuffer and checking for success
-		{
-			writeBuffer = !writeBuffer;							// Use the other buffer for next writing	/// better use [0] and [1], or +1  modulo_2
-		}
-		else	// USB failure or "traffic jam"
+
+/******************************************************************************/
+/**	@brief  WriteCombined - a message of the compact format: 3 bits in the
+ * 			channel and 14 bits in the data bytes
+ *  @param  status: MSG_CMP_...
+ *  @param  value: 17 bits
+*******************************************************************************/
+
+static void WriteCombined(uint8_t status, uint32_t value)
+{
+	WriteMidi(status >> 4, status | (value >> 14), (value >> 7) & 0x7F, value & 0x7F);
+}
+
+
+/******************************************************************************/
+/**	@brief  WriteStamp - with MSG_FORMAT_TIMESTAMPS: the time of the next KD,
+ * 			KU or D message, if it differs from the last timestamp
+*******************************************************************************/
+
+static void WriteStamp(void)
+{
+	if (!(wireFormat & MSG_FORMAT_TIMESTAMPS))
+	{
+		return;
+	}
+
+	if (!eventTimeValid)
+	{
+		eventTime = MSG_GetTime();							// no event time given, valid until the buffer is sent
+		eventTimeValid = 1;
+	}
+
+	if (!stampValid || (eventTime != stampTime))
+	{
+		WriteCombined(MSG_TIMESTAMP, eventTime & 0xFFFF);
+		stampTime = eventTime;
+		stampValid = 1;
+	}
+}
+
+
+/******************************************************************************/
+/**	@brief  WriteP, WriteKeyVoice, WriteDS - single messages of the MIDI format
+*******************************************************************************/
+
+static void WriteP(uint32_t p)
+{
+	WriteMidi(0x08, 0x81, p >> 7, p & 0x7F);										// MIDI channel 1 (P)
+	lastP = p;
+}
+
+static void WriteKeyVoice(uint32_t keyVoice)
+{
+	WriteMidi(0x0B, 0xB7, keyVoice >> 7, keyVoice & 0x7F);						// MIDI channel 7 (KV)
+}
+
+static void WriteDS(uint32_t d, uint32_t sign)
+{
+	WriteStamp();
+
+	if (d > 0x1FFF)															// absolute value does not fit into 13 bits - we use 27 bits
+	{
+		if (d > 0x7FFFFFF)
 		{
-			DBG_Led_Error_On();									// Turn on ERROR LED for USB send problem
-		    COOS_Task_Add(DBG_Led_Error_Off, 40000, 0);
+			d = 0x7FFFFFF;														// clip to 27-bit range
 		}
 
-		buf = 0;		/// Achtung - damit gibt es beim Scheitern keinen zweiten Sendeversuch !!! Wir beobachten die Error-LED
+		WriteMidi(0x0A, 0xA5, (d >> 21) | sign, (d >> 14) & 0x7F);				// MIDI channel 5 (DU)
+		WriteMidi(0x0B, 0xB5, (d >> 7) & 0x7F, d & 0x7F);						// MIDI channel 5 (DL)
+	}
+	else																	// (1+13)-bit format is enough
+	{
+		WriteMidi(0x09, 0x95, (d >> 7) | sign, d & 0x7F);						// MIDI channel 5 (DS)
+	}
+}
+
+
+/******************************************************************************/
+/**	@brief  FlushPending - writes the messages which found no partner for a
+ * 			combined message in the MIDI format, in the order of the calls
+*******************************************************************************/
+
+static void FlushPending(void)
+{
+	if (pending & PEND_P)
+	{
+		WriteP(pendP);
+	}
+
+	if (pending & PEND_KV)
+	{
+		WriteKeyVoice(pendKeyVoice);
+	}
+
+	if (pending & PEND_PITCH)
+	{
+		WriteDS(pendPitch, pendPitchSign);
+	}
+
+	pending = 0;
+}
+
+
+/******************************************************************************/
+/**	@brief  ReceiveSysEx - SysEx messages of the ePC (USB-MIDI parser)
+ * 			F0 7D 20 format F7 selects the wire format, confirmed with
+ * 			F0 7D 21 format F7 as the last message in the old format,
+ * 			format: MSG_FORMAT_MIDI or MSG_FORMAT_COMPACT, plus MSG_FORMAT_TIMESTAMPS
+*******************************************************************************/
+
+static void ReceiveSysEx(uint8_t cable, uint8_t* data, uint32_t len)
+{
+	if ( (len == 5) && (data[1] == MSG_SYSEX_ID) && (data[2] == MSG_SYSEX_SET_FORMAT) && (data[3] <= (MSG_FORMAT_COMPACT | MSG_FORMAT_TIMESTAMPS)) )
+	{
+		FlushPending();
+
+		uint8_t ack[5] = {0xF0, MSG_SYSEX_ID, MSG_SYSEX_FORMAT_ACK, data[3], 0xF7};
+		USB_MIDI_SendSysEx(ack, 5);
+
+		wireFormat = data[3];
+		lastP = 0x3FFF;
+		stampValid = 0;
+	}
+}
+
+
+/******************************************************************************/
+/**	@brief  MSG_Init - takes the format requests of the ePC, after HBT_Init()
+*******************************************************************************/
+
+void MSG_Init(void)
+{
+	wireFormat = MSG_FORMAT_MIDI;
+	pending = 0;
+	stampValid = 0;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;		// cycle counter for MSG_GetTime()
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	USB_MIDI_PARSER_SetSysExHandler(ReceiveSysEx);
+}
+
+
+/******************************************************************************/
+/**	@brief  MSG_GetFormat - the wire format negotiated with the ePC
+*******************************************************************************/
+
+uint32_t MSG_GetFormat(void)
+{
+	return wireFormat;
+}
+
+
+/******************************************************************************/
+/**	@brief  MSG_GetTime - time in us from the DWT cycle counter, wraps around
+ * 			at 2^32 us (called at least once per wrap of the counter, ~21 s)
+*******************************************************************************/
+
+uint32_t MSG_GetTime(void)
+{
+	uint32_t cycles = DWT->CYCCNT;
+	uint32_t diff = cycles - lastCycles + restCycles;
+
+	lastCycles = cycles;
+	timeUs += diff / (NL_LPC_CLK / 1000000);
+	restCycles = diff % (NL_LPC_CLK / 1000000);
+
+	return timeUs;
+}
+
+
+/******************************************************************************/
+/**	@brief  MSG_SetEventTime - the time of the following KD, KU and D messages
+ * 			until the buffer is sent (MSG_FORMAT_TIMESTAMPS), without it
+ * 			they get the time when the first of them is written
+ *  @param  t: time of the event in us (MSG_GetTime)
+*******************************************************************************/
+
+void MSG_SetEventTime(uint32_t t)
+{
+	eventTime = t;
+	eventTimeValid = 1;
+}
+
+
+/******************************************************************************/
+/**	@brief  SendMidiBuffer - completes the written events. With
+ * 			USB_MIDI_SOF_FLUSH the driver sends them with the next start of
+ * 			(micro)frame, together with the following ones, otherwise right away.
+ * 			While the endpoint is busy they wait in the ring.
+*******************************************************************************/
+
+void MSG_SendMidiBuffer(void)
+{
+	FlushPending();
+	USB_MIDI_Flush();
+
+	eventTimeValid = 0;
+
+	uint32_t dropped = USB_MIDI_GetTxStats()->dropped;
+
+	if (dropped != lastDropped)								// the ring has overflowed
+	{
+		lastDropped = dropped;
+
+		DBG_Led_Error_On();									// Turn on ERROR LED for USB send problem
+	    COOS_Task_Add(DBG_Led_Error_Off, 40000, 0);
 	}
 }
 
@@ -113,14 +336,16 @@ void MSG_SelectParameter(uint32_t p)
 			p = 0x3FFE;															// clip to 14 bits (0x3FFF = All)
 		}
 
-		buff[writeBuffer][buf++] = 0x08;										// MIDI status 8
-		buff[writeBuffer][buf++] = 0x81;										// MIDI status 8, MIDI channel 1  (P)
-		buff[writeBuffer][buf++] = p >> 7;										// first 7 bits
-		buff[writeBuffer][buf++] = p & 0x7F;									// second 7 bits
+		FlushPending();
 
-		if (buf == BUFFER_SIZE)
+		if ( (wireFormat & MSG_FORMAT_COMPACT) && (p > lastP) && (p - lastP <= 8) )
 		{
-			MSG_SendMidiBuffer();
+			pendP = p;															// waiting for the D or DS
+			pending = PEND_P;
+		}
+		else
+		{
+			WriteP(p);
 		}
 
 		oldParameter = p;
@@ -144,15 +369,8 @@ void MSG_SelectMultipleParameters(uint32_t p_last)
 			p_last = 0x3FFE;											// clip to 14 bits (0x3FFF = All)
 		}
 
-		buff[writeBuffer][buf++] = 0x09;								// MIDI status 9
-		buff[writeBuffer][buf++] = 0x91;								// MIDI status 9, MIDI channel 1  (PM)
-		buff[writeBuffer][buf++] = p_last >> 7;							// first 7 bits
-		buff[writeBuffer][buf++] = p_last & 0x7F;						// second 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
+		FlushPending();
+		WriteMidi(0x09, 0x91, p_last >> 7, p_last & 0x7F);						// MIDI channel 1 (PM)
 
 		multipleParams = 1;
 	}
@@ -166,6 +384,8 @@ void MSG_SelectMultipleParameters(uint32_t p_last)
 
 void MSG_SetTime(uint32_t t)
 {
+	FlushPending();
+
 	if (t > 0x3FFF)															// needs 28-bit format
 	{
 		if (t > 0xFFFFFFF)
@@ -173,37 +393,12 @@ void MSG_SetTime(uint32_t t)
 			t = 0xFFFFFFF;														// clip to 28 bits
 		}
 
-		buff[writeBuffer][buf++] = 0x0A;										// MIDI status A
-		buff[writeBuffer][buf++] = 0xA2;										// MIDI status A, MIDI channel 2  (TU)
-		buff[writeBuffer][buf++] = (t >> 21);									// first 7 bits
-		buff[writeBuffer][buf++] = (t >> 14) & 0x7F;							// second 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
-
-		buff[writeBuffer][buf++] = 0x0B;										// MIDI status B
-		buff[writeBuffer][buf++] = 0xB2;										// MIDI status B, MIDI channel 2  (TL)
-		buff[writeBuffer][buf++] = (t >> 7) & 0x7F;								// third 7 bits
-		buff[writeBuffer][buf++] = t & 0x7F;									// fourth 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
+		WriteMidi(0x0A, 0xA2, (t >> 21), (t >> 14) & 0x7F);						// MIDI channel 2 (TU)
+		WriteMidi(0x0B, 0xB2, (t >> 7) & 0x7F, t & 0x7F);						// MIDI channel 2 (TL)
 	}
 	else																		// 14-bit format is enough
 	{
-		buff[writeBuffer][buf++] = 0x08;										// MIDI status 8
-		buff[writeBuffer][buf++] = 0x82;										// MIDI status 8, MIDI channel 2  (T)
-		buff[writeBuffer][buf++] = t >> 7;										// first 7 bits
-		buff[writeBuffer][buf++] = t & 0x7F;									// second 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
+		WriteMidi(0x08, 0x82, t >> 7, t & 0x7F);									// MIDI channel 2 (T)
 	}
 }
 
@@ -224,45 +419,28 @@ void MSG_SetDestinationSigned(int32_t d)
 		sign = 0x40;															// first of seven bits
 	}
 
-	if (d > 0x1FFF)															// absolute value does not fit into 13 bits - we use 27 bits
+	if (d <= 0x1FFF)
 	{
-		if (d > 0x7FFFFFF)
+		if (pending == PEND_P)													// P and DS in one message
 		{
-			d = 0x7FFFFFF;														// clip to 27-bit range
+			WriteStamp();
+			WriteCombined(MSG_CMP_P_DS, ((pendP - lastP - 1) << 14) | (sign << 7) | d);
+			lastP = pendP;
+			pending = 0;
+			return;
 		}
 
-		buff[writeBuffer][buf++] = 0x0A;										// MIDI status A
-		buff[writeBuffer][buf++] = 0xA5;										// MIDI status A, MIDI channel 5  (DU)
-		buff[writeBuffer][buf++] = (d >> 21) | sign;							// first 7 bits (sign and upper 6 bits of absolute value)
-		buff[writeBuffer][buf++] = (d >> 14) & 0x7F;							// second 7 bits
-
-		if (buf == BUFFER_SIZE)
+		if (pending == PEND_KV)													// the pitch of a note-on, waiting for the KD
 		{
-			MSG_SendMidiBuffer();
-		}
-
-		buff[writeBuffer][buf++] = 0x0B;										// MIDI status B
-		buff[writeBuffer][buf++] = 0xB5;										// MIDI status B, MIDI channel 5  (DL)
-		buff[writeBuffer][buf++] = (d >> 7) & 0x7F;								// third 7 bits
-		buff[writeBuffer][buf++] = d & 0x7F;									// fourth 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
+			pendPitch = d;
+			pendPitchSign = sign;
+			pending |= PEND_PITCH;
+			return;
 		}
 	}
-	else																	// (1+13)-bit format is enough
-	{
-		buff[writeBuffer][buf++] = 0x09;										// MIDI status 9
-		buff[writeBuffer][buf++] = 0x95;										// MIDI status 9, MIDI channel 5  (DS)
-		buff[writeBuffer][buf++] = (d >> 7) | sign;								// first 7 bits (sign and upper 6 bits of absolute value)
-		buff[writeBuffer][buf++] = d & 0x7F;									// second 7 bits
 
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
-	}
+	FlushPending();
+	WriteDS(d, sign);
 }
 
 
@@ -274,6 +452,18 @@ void MSG_SetDestinationSigned(int32_t d)
 
 void MSG_SetDestination(uint32_t d)
 {
+	if ( (pending == PEND_P) && (d <= 0x3FFF) )								// P and D in one message
+	{
+		WriteStamp();
+		WriteCombined(MSG_CMP_P_D, ((pendP - lastP - 1) << 14) | d);
+		lastP = pendP;
+		pending = 0;
+		return;
+	}
+
+	FlushPending();
+	WriteStamp();
+
 	if (d > 0x3FFF)															// value does not fit into 14 bits - we use 27 bits
 	{
 		if (d > 0x7FFFFFF)
@@ -281,37 +471,12 @@ void MSG_SetDestination(uint32_t d)
 			d = 0x7FFFFFF;														// clip to 27-bit range (setting the sign bit to zero)
 		}
 
-		buff[writeBuffer][buf++] = 0x0A;										// MIDI status A
-		buff[writeBuffer][buf++] = 0xA5;										// MIDI status A, MIDI channel 5  (DU)
-		buff[writeBuffer][buf++] = (d >> 21);									// first 7 bits (sign is zero)
-		buff[writeBuffer][buf++] = (d >> 14) & 0x7F;							// second 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
-
-		buff[writeBuffer][buf++] = 0x0B;										// MIDI status B
-		buff[writeBuffer][buf++] = 0xB5;										// MIDI status B, MIDI channel 5  (DL)
-		buff[writeBuffer][buf++] = (d >> 7) & 0x7F;								// third 7 bits
-		buff[writeBuffer][buf++] = d & 0x7F;									// fourth 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
+		WriteMidi(0x0A, 0xA5, (d >> 21), (d >> 14) & 0x7F);						// MIDI channel 5 (DU)
+		WriteMidi(0x0B, 0xB5, (d >> 7) & 0x7F, d & 0x7F);						// MIDI channel 5 (DL)
 	}
 	else																	// 14-bit format is enough
 	{
-		buff[writeBuffer][buf++] = 0x08;										// MIDI status 8
-		buff[writeBuffer][buf++] = 0x85;										// MIDI status 8, MIDI channel 5  (D)
-		buff[writeBuffer][buf++] = d >> 7;										// first 7 bits
-		buff[writeBuffer][buf++] = d & 0x7F;									// second 7 bits
-
-		if (buf == BUFFER_SIZE)
-		{
-			MSG_SendMidiBuffer();
-		}
+		WriteMidi(0x08, 0x85, d >> 7, d & 0x7F);									// MIDI channel 5 (D)
 	}
 }
 
@@ -326,14 +491,16 @@ void MSG_KeyVoice(uint32_t steal, uint32_t voice)
 {
 	uint32_t keyVoice = (steal ? 1 : 0) + (voice << 1);
 
-	buff[writeBuffer][buf++] = 0x0B;										// MIDI status B
-	buff[writeBuffer][buf++] = 0xB7;										// MIDI status B, MIDI channel 7  (KV)
-	buff[writeBuffer][buf++] = keyVoice >> 7;								// first 7 bits
-	buff[writeBuffer][buf++] = keyVoice & 0x7F;								// second 7 bits
+	FlushPending();
 
-	if (buf == BUFFER_SIZE)
+	if ( (wireFormat & MSG_FORMAT_COMPACT) && (keyVoice < 64) )
+	{
+		pendKeyVoice = keyVoice;												// waiting for the pitch and KD, or the KU
+		pending = PEND_KV;
+	}
+	else
 	{
-		MSG_SendMidiBuffer();
+		WriteKeyVoice(keyVoice);
 	}
 }
 
@@ -346,15 +513,18 @@ void MSG_KeyVoice(uint32_t steal, uint32_t voice)
 
 void MSG_KeyDown(uint32_t vel)
 {
-	buff[writeBuffer][buf++] = 0x09;										// MIDI status 9
-	buff[writeBuffer][buf++] = 0x97;										// MIDI status 9, MIDI channel 7  (KD)
-	buff[writeBuffer][buf++] = vel >> 7;									// first 7 bits
-	buff[writeBuffer][buf++] = vel & 0x7F;									// second 7 bits
-
-	if (buf == BUFFER_SIZE)
+	if ( (pending == (PEND_KV | PEND_PITCH)) && (vel <= 0xFFF) )			// KV, DS and KD in two messages
 	{
-		MSG_SendMidiBuffer();
+		WriteStamp();
+		WriteCombined(MSG_CMP_NOTE_ON_A, (pendKeyVoice << 11) | ((pendPitchSign ? 1 : 0) << 10) | (pendPitch >> 3));
+		WriteCombined(MSG_CMP_NOTE_ON_B, ((pendPitch & 0x07) << 12) | vel);
+		pending = 0;
+		return;
 	}
+
+	FlushPending();
+	WriteStamp();
+	WriteMidi(0x09, 0x97, vel >> 7, vel & 0x7F);									// MIDI channel 7 (KD)
 }
 
 
@@ -366,15 +536,17 @@ void MSG_KeyDown(uint32_t vel)
 
 void MSG_KeyUp(uint32_t vel)
 {
-	buff[writeBuffer][buf++] = 0x08;										// MIDI status 8
-	buff[writeBuffer][buf++] = 0x87;										// MIDI status 8, MIDI channel 7  (KU)
-	buff[writeBuffer][buf++] = vel >> 7;									// first 7 bits
-	buff[writeBuffer][buf++] = vel & 0x7F;									// second 7 bits
-
-	if (buf == BUFFER_SIZE)
+	if ( (pending == PEND_KV) && !(pendKeyVoice & 0x01) && (vel <= 0xFFF) )	// KV (not stealing) and KU in one message
 	{
-		MSG_SendMidiBuffer();
+		WriteStamp();
+		WriteCombined(MSG_CMP_NOTE_OFF, ((pendKeyVoice >> 1) << 12) | vel);
+		pending = 0;
+		return;
 	}
+
+	FlushPending();
+	WriteStamp();
+	WriteMidi(0x08, 0x87, vel >> 7, vel & 0x7F);									// MIDI channel 7 (KU)
 }
 
 
@@ -392,15 +564,8 @@ void MSG_KeyUp(uint32_t vel)
 
 void PreloadMode(uint32_t m)
 {
-	buff[writeBuffer][buf++] = 0x0A;										// MIDI status A
-	buff[writeBuffer][buf++] = 0xAF;										// MIDI status A, MIDI channel F  (PL)
-	buff[writeBuffer][buf++] = m >> 7;										// first 7 bits
-	buff[writeBuffer][buf++] = m & 0x7F;									// second 7 bits
-
-	if (buf == BUFFER_SIZE)
-	{
-		MSG_SendMidiBuffer();
-	}
+	FlushPending();
+	WriteMidi(0x0A, 0xAF, m >> 7, m & 0x7F);										// MIDI channel F (PL)
 }
 
 
@@ -433,13 +598,6 @@ void MSG_ApplyPreloadedValues(void)
 
 void MSG_Reset(uint32_t mode)
 {
-	buff[writeBuffer][buf++] = 0x0A;										// MIDI status A
-	buff[writeBuffer][buf++] = 0xA7;										// MIDI status A, MIDI channel 7  (RST)
-	buff[writeBuffer][buf++] = mode >> 7;									// first 7 bits
-	buff[writeBuffer][buf++] = mode & 0x7F;									// second 7 bits
-
-	if (buf == BUFFER_SIZE)
-	{
-		MSG_SendMidiBuffer();
-	}
+	FlushPending();
+	WriteMidi(0x0A, 0xA7, mode >> 7, mode & 0x7F);								// MIDI channel 7 (RST)
 }
@@ -26,11 +26,50 @@
 #define SEGMENT_PRIO_INSERT_OPEN 	256
 #define SEGMENT_PRIO_INSERT_CLOSED	384
 
+/* wire formats of the messages to the ePC, negotiated with SysEx messages (ID 0x7D, non-commercial):
+     ePC -> LPC  F0 7D 20 format F7
+     LPC -> ePC  F0 7D 21 format F7, the following messages use the new format
+   MSG_FORMAT_COMPACT adds messages on the unused status bytes, which combine two or three
+   messages of MSG_FORMAT_MIDI (3 bits in the channel + 14 bits = 17 bits each):
+     MSG_CMP_P_D        P (last P + 1 ... 8) and D:   (delta - 1):3  D:14
+     MSG_CMP_P_DS       P (last P + 1 ... 8) and DS:  (delta - 1):3  sign:1  |DS|:13
+     MSG_CMP_NOTE_ON_A  KV and DS (pitch) ...         KV:6  sign:1  |DS| >> 3:10
+     MSG_CMP_NOTE_ON_B  ... and KD, always follows A  |DS| & 7:3  spare:2  KD:12
+     MSG_CMP_NOTE_OFF   KV (not stealing) and KU:     voice:5  KU:12
+   Values out of range and single messages keep the MIDI format.
+   MSG_FORMAT_TIMESTAMPS can be added to both formats: a MSG_TIMESTAMP message (16 bits of the
+   LPC time in us, 2 bits in the channel + 14 bits) precedes the KD, KU, D, DS, DU and combined
+   messages whenever their event time differs from the last timestamp. It applies to all following
+   messages until the next one. The time wraps around every 65.536 ms, the receiver extends it
+   with its own clock.
+   Reference decoder: tools/tcd_compact/tcd_compact_decode.c */
+#define MSG_FORMAT_MIDI				0
+#define MSG_FORMAT_COMPACT			1
+#define MSG_FORMAT_TIMESTAMPS		2				// flag, combined with one of the formats above
+
+#define MSG_SYSEX_ID				0x7D
+#define MSG_SYSEX_SET_FORMAT		0x20
+#define MSG_SYSEX_FORMAT_ACK		0x21
+
+#define MSG_CMP_P_D					0x88			// 0x88 ... 0x8F
+#define MSG_CMP_P_DS				0xB8			// 0xB8 ... 0xBF
+#define MSG_CMP_NOTE_ON_A			0xE0			// 0xE0 ... 0xE7
+#define MSG_CMP_NOTE_ON_B			0xE8			// 0xE8 ... 0xEF
+#define MSG_CMP_NOTE_OFF			0x98			// 0x98 ... 0x9F
+
+#define MSG_TIMESTAMP				0xA8			// 0xA8 ... 0xAB
+
 
 /******************************************************************************
 *	public functions
 ******************************************************************************/
 
+void MSG_Init(void);
+uint32_t MSG_GetFormat(void);
+
+uint32_t MSG_GetTime(void);
+void MSG_SetEventTime(uint32_t t);
+
 void MSG_CheckUSB(void);
 void MSG_SendMidiBuffer(void);
 
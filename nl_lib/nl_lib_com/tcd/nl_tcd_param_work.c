@@ -24,14 +24,109 @@ static int16_t minValue[NUM_UI_PARAMS];			// lower limit of the parameter
 static int16_t maxValue[NUM_UI_PARAMS];			// upper limit of the parameter
 
 
-//------------------------ Storage for the MC amounts and linked list
+//------------------------ Storage for the MC amounts and target lists
+
+#define MC_GAIN_SHIFT		4				// fractional bits of the target gains: |3200 * gain| stays below 2^31 for amounts up to 8191 and ranges up to 16160
+#define MC_TARGET_NONE		0xFF			// back-index of a parameter that is not in any target list
+
+typedef struct {
+	uint16_t amtId;							// Id of the MC amount, the target parameter is the one before
+	int32_t  gain;							// mcAmount * (max - min) / 3200, up-scaled by 2^MC_GAIN_SHIFT
+} MC_TARGET_T;
 
 static int16_t mcAmount[NUM_UI_PARAMS];			// decoded mc amounts
 
 static uint16_t assignedMCTargets[NUM_MCS];				// length of the list of assigned targets
-static uint16_t mcTarget[NUM_MCS][NUM_MC_TARGETS];		// Ids of the target parameters of an MC
+static MC_TARGET_T mcTarget[NUM_MCS][NUM_MC_TARGETS];	// targets of an MC, unordered
+static uint8_t mcTargetIndex[NUM_UI_PARAMS];			// back-index: position of an MC amount in the target list of its MC
+
+
+
+//------------------------ Play control -> MC matrix
+
+#define PC_PEDAL_1			0
+#define PC_PEDAL_2			1
+#define PC_PEDAL_3			2
+#define PC_PEDAL_4			3
+#define PC_PITCHBEND		4
+#define PC_AFTERTOUCH		5
+#define PC_RIBBON_1		6
+#define PC_RIBBON_2		7
+
+static const uint16_t pcParamId[NUM_PCS] =
+				{	PARAM_ID_PEDAL_1,
+					PARAM_ID_PEDAL_2,
+					PARAM_ID_PEDAL_3,
+					PARAM_ID_PEDAL_4,
+					PARAM_ID_PITCHBEND,
+					PARAM_ID_AFTERTOUCH,
+					PARAM_ID_RIBBON_1,
+					PARAM_ID_RIBBON_2	};
+
+static const uint16_t pcAmountId[NUM_PCS][NUM_MCS] =
+				{	{ PARAM_ID_PEDAL_1_TO_MC_A,    PARAM_ID_PEDAL_1_TO_MC_B,    PARAM_ID_PEDAL_1_TO_MC_C,    PARAM_ID_PEDAL_1_TO_MC_D    },
+					{ PARAM_ID_PEDAL_2_TO_MC_A,    PARAM_ID_PEDAL_2_TO_MC_B,    PARAM_ID_PEDAL_2_TO_MC_C,    PARAM_ID_PEDAL_2_TO_MC_D    },
+					{ PARAM_ID_PEDAL_3_TO_MC_A,    PARAM_ID_PEDAL_3_TO_MC_B,    PARAM_ID_PEDAL_3_TO_MC_C,    PARAM_ID_PEDAL_3_TO_MC_D    },
+					{ PARAM_ID_PEDAL_4_TO_MC_A,    PARAM_ID_PEDAL_4_TO_MC_B,    PARAM_ID_PEDAL_4_TO_MC_C,    PARAM_ID_PEDAL_4_TO_MC_D    },
+					{ PARAM_ID_PITCHBEND_TO_MC_A,  PARAM_ID_PITCHBEND_TO_MC_B,  PARAM_ID_PITCHBEND_TO_MC_C,  PARAM_ID_PITCHBEND_TO_MC_D  },
+					{ PARAM_ID_AFTERTOUCH_TO_MC_A, PARAM_ID_AFTERTOUCH_TO_MC_B, PARAM_ID_AFTERTOUCH_TO_MC_C, PARAM_ID_AFTERTOUCH_TO_MC_D },
+					{ PARAM_ID_RIBBON_1_TO_MC_A,   PARAM_ID_RIBBON_1_TO_MC_B,   PARAM_ID_RIBBON_1_TO_MC_C,   PARAM_ID_RIBBON_1_TO_MC_D   },
+					{ PARAM_ID_RIBBON_2_TO_MC_A,   PARAM_ID_RIBBON_2_TO_MC_B,   PARAM_ID_RIBBON_2_TO_MC_C,   PARAM_ID_RIBBON_2_TO_MC_D   }	};
+
+static int32_t pcGain[NUM_PCS][NUM_MCS];		// decoded PC amounts (-8000 ... 8000, pitchbend -16000 ... 16000)
+static uint8_t pcActiveMCs[NUM_PCS];			// bit n is set if the PC has a non-zero amount for MC n
+
+
+//------------------------ Coalescing of the modulated parameters
+
+#define PARAM_FLUSH_BUDGET	32					// maximum number of parameters sent per flush (32 * 8 bytes of USB-MIDI)
+
+#define DIRTY_NONE			0					// not in the list
+#define DIRTY_PENDING		1					// in the list, waiting to be sent
+#define DIRTY_CANCELED		2					// in the list, but the value has already been sent directly
 
+static uint16_t dirtyParam[NUM_UI_PARAMS];		// Ids of the parameters changed by MCs since the last flush, each Id appears only once
+static uint16_t numDirty;
+static uint8_t dirtyState[NUM_UI_PARAMS];
 
+static uint16_t minUpdateInterval[NUM_UI_PARAMS];	// minimum time between two updates of a target [flush ticks]
+static uint32_t lastUpdateTick[NUM_UI_PARAMS];			// [flush ticks], 32 bits: 16 bits would wrap after 8.2 s
+static uint32_t flushTick;
+
+
+
+//------- how the parameters of a preset are applied
+
+#define PARAM_TYPE_BASIC			0			// sent to the TCD renderer, can be interpolated
+#define PARAM_TYPE_PLAY_CONTROL		1			// ignored, the hardware sources own them
+#define PARAM_TYPE_MACRO_CONTROL	2
+#define PARAM_TYPE_PC_AMOUNT		3
+#define PARAM_TYPE_MC_AMOUNT		4
+#define PARAM_TYPE_SCALE_BASE		5
+#define PARAM_TYPE_SCALE_OFFSET		6
+
+//------- time-sliced preset recall
+
+#define PRESET_BUDGET_DEFAULT	32				// parameters applied per tick, a complete preset takes 11 ticks (1.4 ms)
+
+static uint16_t presetData[NUM_UI_PARAMS];		// copy of the preset, the message buffer is released after the call
+static uint16_t presetLength;
+static uint16_t presetPos;						// next parameter to apply
+static uint32_t presetBusy;
+static uint32_t presetBudget;
+static void (*presetCallback)(void);			// called after the preloaded values have been applied
+
+
+//------- morphing between two preset images
+
+#define MORPH_SIDE_NONE		0xFF				// the discrete parameters are not taken from an image yet
+
+static uint16_t morphImage[2][NUM_UI_PARAMS];	// 0: image A, 1: image B, same format as a preset
+static uint16_t morphLength[2];					// 0: image not loaded
+static uint32_t morphPos;						// 0: A ... 16000: B
+static uint32_t morphPending;					// the position has changed since the last PARAM_WORK_Process
+static uint32_t morphSide;						// image of the discrete parameters: 0: A, 1: B (switching at 8000)
+static uint32_t morphLastPos;					// position of the last ApplyMorph, valid unless morphSide is MORPH_SIDE_NONE
 
 static uint32_t transitionTime;
 static uint32_t updateTransitionTime;
@@ -56,7 +151,8 @@ void PARAM_WORK_Init(void)
 
 		for (i = 0; i < NUM_MC_TARGETS; i++)
 		{
-			mcTarget[mcId][i] = 0;
+			mcTarget[mcId][i].amtId = 0;
+			mcTarget[mcId][i].gain = 0;
 		}
 	}
 
@@ -67,7 +163,11 @@ void PARAM_WORK_Init(void)
 	{
 		paramValue[i] = 0;
 		mcAmount[i] = 0;
+		mcTargetIndex[i] = MC_TARGET_NONE;
 		modulatedValue[i] = 0;
+		dirtyState[i] = DIRTY_NONE;
+		minUpdateInterval[i] = 0;
+		lastUpdateTick[i] = 0;
 
 		switch (i)
 		{
@@ -254,8 +354,34 @@ void PARAM_WORK_Init(void)
 		}
 	}
 
+	for (i = 0; i < NUM_PCS; i++)
+	{
+		for (mcId = 0; mcId < NUM_MCS; mcId++)
+		{
+			pcGain[i][mcId] = 0;
+		}
+
+		pcActiveMCs[i] = 0;
+	}
+
 	paramValue[PARAM_ID_PITCHBEND] = 8000;
 
+	numDirty = 0;
+	flushTick = 0;
+
+	presetLength = 0;
+	presetPos = 0;
+	presetBusy = 0;
+	presetBudget = PRESET_BUDGET_DEFAULT;
+	presetCallback = 0;
+
+	morphLength[0] = 0;
+	morphLength[1] = 0;
+	morphPos = 0;
+	morphPending = 0;
+	morphSide = MORPH_SIDE_NONE;
+	morphLastPos = 0;
+
 	transitionTime = 100; 		/// default: 30 ms - Fehler in Exp-Curve ???
 	updateTransitionTime = 0;
 	smoothingTime = 800; 		// default: 10 ms
@@ -267,7 +393,7 @@ void PARAM_WORK_Init(void)
 
 //===================== Elementary Parameters
 
-static void ProcessBasicParam(uint32_t paramId, int32_t paramVal)
+static void SendBasicParam(uint32_t paramId, int32_t paramVal)
 {
 	switch (paramId)
 	{
@@ -349,8 +475,48 @@ static void ProcessBasicParam(uint32_t paramId, int32_t paramVal)
 			MSG_SelectParameter(paramId);
 			MSG_SetDestination(paramVal);
 	}
+}
+
+
+static void ProcessBasicParam(uint32_t paramId, int32_t paramVal)		// sending immediately
+{
+	SendBasicParam(paramId, paramVal);
+
+	paramValue[paramId] = paramVal;
+
+	if (dirtyState[paramId] == DIRTY_PENDING)
+	{
+		dirtyState[paramId] = DIRTY_CANCELED;		// the pending MC update is obsolete
+	}
+
+	lastUpdateTick[paramId] = flushTick;
+}
+
 
+static void QueueBasicParam(uint32_t paramId, int32_t paramVal)		// sending with the next flush
+{
 	paramValue[paramId] = paramVal;
+
+	if (dirtyState[paramId] == DIRTY_NONE)
+	{
+		dirtyParam[numDirty] = paramId;
+		numDirty++;
+	}
+
+	dirtyState[paramId] = DIRTY_PENDING;
+}
+
+
+static void ClearDirtyParams(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < numDirty; i++)
+	{
+		dirtyState[dirtyParam[i]] = DIRTY_NONE;
+	}
+
+	numDirty = 0;
 }
 
 
@@ -381,19 +547,48 @@ static void ProcessBasicParamDirectly(uint32_t paramId, uint32_t paramVal)
 
 static void SetPCAmount(uint32_t paramId, uint32_t paramVal)
 {
+	int32_t amount;
+
 	if (paramVal & 0x8000)
 	{
-		paramValue[paramId] = -(paramVal & 0x7FFF);
+		amount = -(paramVal & 0x7FFF);
 	}
 	else
 	{
-		paramValue[paramId] = paramVal;
+		amount = paramVal;
 	}
 
-	if ( (paramId == 275) || (paramId == 276) || (paramId == 277) || (paramId == 278) )
+	if ( (paramId >= PARAM_ID_PITCHBEND_TO_MC_A) && (paramId <= PARAM_ID_PITCHBEND_TO_MC_D) )
 	{
-		paramValue[paramId] *= 2; 	// In the UI the pitchbend range is bipolar (-1...1). Therefore the amounts are 1/2 of the others.
-	}								// But here the ADC range is 0...16000, like the others.
+		amount *= 2; 	// In the UI the pitchbend range is bipolar (-1...1). Therefore the amounts are 1/2 of the others.
+	}					// But here the ADC range is 0...16000, like the others.
+
+	paramValue[paramId] = amount;
+
+	uint32_t pc;
+	uint32_t mc;
+
+	for (pc = 0; pc < NUM_PCS; pc++)
+	{
+		for (mc = 0; mc < NUM_MCS; mc++)
+		{
+			if (pcAmountId[pc][mc] == paramId)
+			{
+				pcGain[pc][mc] = amount;
+
+				if (amount)
+				{
+					pcActiveMCs[pc] |= (1 << mc);
+				}
+				else
+				{
+					pcActiveMCs[pc] &= ~(1 << mc);
+				}
+
+				return;
+			}
+		}
+	}
 }
 
 
@@ -417,7 +612,9 @@ static void AddMCTarget(uint16_t amtId, uint32_t mcId)
 		}
 		else
 		{
-			mcTarget[mcId][length] = amtId;			// appending the Id of the target at the end of the list
+			mcTarget[mcId][length].amtId = amtId;	// appending the Id of the target at the end of the list
+			mcTarget[mcId][length].gain = 0;		// set by SetMCAmount()
+			mcTargetIndex[amtId] = length;
 			assignedMCTargets[mcId] = length + 1;	// the length of the list is increased
 		}
 	}
@@ -433,24 +630,20 @@ static void RemoveMCTarget(uint16_t amtId, uint32_t mcId)
 	else
 	{
 		uint16_t length = assignedMCTargets[mcId];
-		uint32_t i;
+		uint32_t i = mcTargetIndex[amtId];
 
-		for (i = 0; i < length; i++)
+		if ( (i >= length) || (mcTarget[mcId][i].amtId != amtId) )		// not in the list of this MC
 		{
-			if (mcTarget[mcId][i] == amtId)				// finding the target that should be removed
-			{
-				uint32_t j;
+			return; 					/// assertion
+		}
 
-				for (j = i; j < (length - 1); j++)
-				{
-					mcTarget[mcId][j] = mcTarget[mcId][j + 1];	// filling the gap - the rest of the targets are moved down
-				}
+		length--;
 
-				assignedMCTargets[mcId] = length - 1;			// the length of the list is decreased
+		mcTarget[mcId][i] = mcTarget[mcId][length];		// filling the gap with the last target of the list
+		mcTargetIndex[mcTarget[mcId][i].amtId] = i;
 
-				break;
-			}
-		}
+		mcTargetIndex[amtId] = MC_TARGET_NONE;
+		assignedMCTargets[mcId] = length;				// the length of the list is decreased
 	}
 }
 
@@ -487,6 +680,15 @@ static void SetMCAmount(uint32_t amtId, uint32_t srcAndAmt)
 		{
 			AddMCTarget(amtId, srcId);
 		}
+
+		uint32_t i = mcTargetIndex[amtId];
+
+		if (i != MC_TARGET_NONE)
+		{
+			uint32_t paramId = amtId - 1;		// assuming that the Id of the destination is the one before the Id of its MC amount
+
+			mcTarget[srcId][i].gain = (amt * (maxValue[paramId] - minValue[paramId]) * (1 << MC_GAIN_SHIFT)) / 3200;	// down-scaled by the MC Range (3200)
+		}
 	}
 
 	mcAmount[amtId] = amt;
@@ -498,27 +700,22 @@ static void SetMCAmount(uint32_t amtId, uint32_t srcAndAmt)
 
 //--------------------------- ApplyMCToParam
 
-static void ApplyMCToParam(uint32_t amtId, int32_t mcInc)
+static void ApplyMCToParam(const MC_TARGET_T* target, int32_t mcInc)		// mcInc: -3200 ... 3200
 {
 	int32_t paramVal;
 	uint32_t paramId;
 
-	paramId = amtId - 1;			// assuming that the Id of the destination is the one before the Id of its MC amount
+	paramId = target->amtId - 1;		// assuming that the Id of the destination is the one before the Id of its MC amount
 
-	int64_t min = minValue[paramId];
-	int64_t max = maxValue[paramId];
+	modulatedValue[paramId] += (mcInc * target->gain) / (1 << MC_GAIN_SHIFT);	// up-scaled by the range of mcAmount, rounded towards zero (no drift for up and down moves)
+	paramVal = modulatedValue[paramId] / maxMCAmount[paramId];				// down-scaled by the range of mcAmount
 
-	int64_t weightedInc = mcInc * mcAmount[amtId];						// up-scaled by the range of mcAmount
+	if (paramVal > maxValue[paramId])
+		paramVal = maxValue[paramId];
+	else if (paramVal < minValue[paramId])
+		paramVal = minValue[paramId];
 
-	modulatedValue[paramId] += (weightedInc * (max - min)) / 3200;		// down-scaled by the the MC Range (3200)
-	paramVal = modulatedValue[paramId] / maxMCAmount[paramId];			// down-scaled by the range of mcAmount
-
-	if (paramVal > max)
-		paramVal = max;
-	else if (paramVal < min)
-		paramVal = min;
-
-	ProcessBasicParam(paramId, paramVal);
+	QueueBasicParam(paramId, paramVal);
 }
 
 
@@ -526,29 +723,16 @@ static void ApplyMCToParam(uint32_t amtId, int32_t mcInc)
 
 static void ProcessMacroControl(uint32_t mcId, uint32_t mcVal)		// mcVal: 0 ... 3200
 {
-	uint16_t length;
-	uint16_t* target;
+	uint32_t mc = mcId - PARAM_ID_MACRO_CONTROL_A;
 
-	switch (mcId)
+	if (mc >= NUM_MCS)
 	{
-		case PARAM_ID_MACRO_CONTROL_A:
-			length = assignedMCTargets[0];
-			target = mcTarget[0];
-			break;
-		case PARAM_ID_MACRO_CONTROL_B:
-			length = assignedMCTargets[1];
-			target = mcTarget[1];
-			break;
-		case PARAM_ID_MACRO_CONTROL_C:
-			length = assignedMCTargets[2];
-			target = mcTarget[2];
-			break;
-		case PARAM_ID_MACRO_CONTROL_D:
-			length = assignedMCTargets[3];
-			target = mcTarget[3];
-			break;
-		default:
-			return;
+		return;
+	}
+
+	if (mcVal > 3200)
+	{
+		mcVal = 3200;
 	}
 
 	int32_t inc;
@@ -556,11 +740,13 @@ static void ProcessMacroControl(uint32_t mcId, uint32_t mcVal)		// mcVal: 0 ...
 	inc = mcVal - paramValue[mcId];
 	paramValue[mcId] = mcVal;
 
+	const MC_TARGET_T* target = mcTarget[mc];
+	uint32_t length = assignedMCTargets[mc];
 	uint32_t i;
 
 	for (i = 0; i < length; i++)
 	{
-		ApplyMCToParam(target[i], inc);
+		ApplyMCToParam(&target[i], inc);
 	}
 }
 
@@ -575,96 +761,45 @@ static void ProcessMacroControlDirectly(uint32_t mcId, uint32_t mcVal)	// mcVal:
 
 //------------------------ ProcessPlayControl
 
-static void ProcessPlayControl(uint32_t pcId, uint32_t pcVal, uint32_t behaviour)	// pcVal is for all in the range 0 ... 16000 (Pitchbend center at 8000)
+static void ProcessPlayControl(uint32_t pc, uint32_t pcVal, uint32_t behaviour)	// pcVal is for all in the range 0 ... 16000 (Pitchbend center at 8000)
 {
+	uint32_t pcId = pcParamId[pc];
 	int32_t inc;
-	int32_t mcVal;
 
 	inc = pcVal - paramValue[pcId];
 	paramValue[pcId] = pcVal;
-	
-	if (paramValue[pcId + 1])			// the PC amounts are located at the next 4 Ids after the play control
-	{
-		if (behaviour == NON_RETURN)
-		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_A] = pcVal * 8000;		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_A] / 40000;		// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
-		}
-		else
-		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_A] += inc * paramValue[pcId + 1];		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_A] / 40000;					// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
 
-			if (mcVal > 3200)
-				mcVal = 3200;
-			else if (mcVal < 0)
-				mcVal = 0;
-		}
-
-		ProcessMacroControl(PARAM_ID_MACRO_CONTROL_A, mcVal);
-	}
+	uint32_t active = pcActiveMCs[pc];
+	const int32_t* gain = pcGain[pc];
+	int32_t* mcModulated = &modulatedValue[PARAM_ID_MACRO_CONTROL_A];
+	int32_t mcVal[NUM_MCS];
+	uint32_t mc;
 
-	if (paramValue[pcId + 2])
+	for (mc = 0; mc < NUM_MCS; mc++)		// first pass: the new values of all MCs driven by this PC
 	{
 		if (behaviour == NON_RETURN)
 		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_B] = pcVal * 8000;		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_B] / 40000;		// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
+			mcModulated[mc] = (active & (1 << mc)) ? (int32_t)(pcVal * 8000) : mcModulated[mc];	// up-scaled by the range of the PC Amount (-8000 ... 8000)
 		}
 		else
 		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_B] += inc * paramValue[pcId + 2];		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_B] / 40000;					// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
-
-			if (mcVal > 3200)
-				mcVal = 3200;
-			else if (mcVal < 0)
-				mcVal = 0;
-		}
-
-		ProcessMacroControl(PARAM_ID_MACRO_CONTROL_B, mcVal);
-	}
-
-	if (paramValue[pcId + 3])
-	{
-		if (behaviour == NON_RETURN)
-		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_C] = pcVal * 8000;		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_C] / 40000;		// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
+			mcModulated[mc] += inc * gain[mc];													// up-scaled by the range of the PC Amount (-8000 ... 8000), zero for inactive MCs
 		}
-		else
-		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_C] += inc * paramValue[pcId + 3];		// up-scaled by the range of the PC Amount (8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_C] / 40000;					// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
 
-			if (mcVal > 3200)
-				mcVal = 3200;
-			else if (mcVal < 0)
-				mcVal = 0;
-		}
+		mcVal[mc] = mcModulated[mc] / 40000;						// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
 
-		ProcessMacroControl(PARAM_ID_MACRO_CONTROL_C, mcVal);
+		if (mcVal[mc] > 3200)
+			mcVal[mc] = 3200;
+		else if (mcVal[mc] < 0)
+			mcVal[mc] = 0;
 	}
 
-	if (paramValue[pcId + 4])
+	for (mc = 0; mc < NUM_MCS; mc++)		// second pass: the targets of the MCs that have changed
 	{
-		if (behaviour == NON_RETURN)
+		if (active & (1 << mc))
 		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_D] = pcVal * 8000;		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_D] / 40000;		// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
+			ProcessMacroControl(PARAM_ID_MACRO_CONTROL_A + mc, mcVal[mc]);
 		}
-		else
-		{
-			modulatedValue[PARAM_ID_MACRO_CONTROL_D] += inc * paramValue[pcId + 4];		// up-scaled by the range of the PC Amount (-8000 ... 8000)
-			mcVal = modulatedValue[PARAM_ID_MACRO_CONTROL_D] / 40000;					// down-scaled by 5 * 8000 (pcVal is 5 times larger than mcVal)
-
-			if (mcVal > 3200)
-				mcVal = 3200;
-			else if (mcVal < 0)
-				mcVal = 0;
-		}
-
-		ProcessMacroControl(PARAM_ID_MACRO_CONTROL_D, mcVal);
 	}
 }
 
@@ -687,8 +822,6 @@ void PARAM_Set(uint32_t paramId, uint32_t paramVal)
 {
 	if (paramId < NUM_UI_PARAMS)
 	{
-		ADC_WORK_Suspend();
-
 		if ( (usingTransitionTime == 1) || (updateSmoothingTime == 1) )
 		{
 			SetAllTimes(smoothingTime);			// switching from transition smoothing to edit smoothing
@@ -700,28 +833,28 @@ void PARAM_Set(uint32_t paramId, uint32_t paramVal)
 		switch (paramId)
 		{
 			case PARAM_ID_PEDAL_1:
-				ProcessPlayControl(PARAM_ID_PEDAL_1, paramVal, ADC_WORK_GetPedal1Behaviour());
+				ProcessPlayControl(PC_PEDAL_1, paramVal, ADC_WORK_GetPedal1Behaviour());
 				break;
 			case PARAM_ID_PEDAL_2:
-				ProcessPlayControl(PARAM_ID_PEDAL_2, paramVal, ADC_WORK_GetPedal2Behaviour());
+				ProcessPlayControl(PC_PEDAL_2, paramVal, ADC_WORK_GetPedal2Behaviour());
 				break;
 			case PARAM_ID_PEDAL_3:
-				ProcessPlayControl(PARAM_ID_PEDAL_3, paramVal, ADC_WORK_GetPedal3Behaviour());
+				ProcessPlayControl(PC_PEDAL_3, paramVal, ADC_WORK_GetPedal3Behaviour());
 				break;
 			case PARAM_ID_PEDAL_4:
-				ProcessPlayControl(PARAM_ID_PEDAL_4, paramVal, ADC_WORK_GetPedal4Behaviour());
+				ProcessPlayControl(PC_PEDAL_4, paramVal, ADC_WORK_GetPedal4Behaviour());
 				break;
 			case PARAM_ID_PITCHBEND:
-				ProcessPlayControl(PARAM_ID_PITCHBEND, paramVal, RETURN_TO_CENTER);
+				ProcessPlayControl(PC_PITCHBEND, paramVal, RETURN_TO_CENTER);
 				break;
 			case PARAM_ID_AFTERTOUCH:
-				ProcessPlayControl(PARAM_ID_AFTERTOUCH, paramVal, RETURN_TO_ZERO);
+				ProcessPlayControl(PC_AFTERTOUCH, paramVal, RETURN_TO_ZERO);
 				break;
 			case PARAM_ID_RIBBON_1:
-				ProcessPlayControl(PARAM_ID_RIBBON_1, paramVal, ADC_WORK_GetRibbon1Behaviour());
+				ProcessPlayControl(PC_RIBBON_1, paramVal, ADC_WORK_GetRibbon1Behaviour());
 				break;
 			case PARAM_ID_RIBBON_2:
-				ProcessPlayControl(PARAM_ID_RIBBON_2, paramVal, ADC_WORK_GetRibbon2Behaviour());
+				ProcessPlayControl(PC_RIBBON_2, paramVal, ADC_WORK_GetRibbon2Behaviour());
 				break;
 
 			case PARAM_ID_MACRO_CONTROL_A:
@@ -787,8 +920,6 @@ void PARAM_Set(uint32_t paramId, uint32_t paramVal)
 			default:
 				ProcessBasicParamDirectly(paramId, paramVal);
 		}
-
-		ADC_WORK_Resume();
 	}
 }
 
@@ -798,8 +929,6 @@ void PARAM_Set2(uint32_t paramId, uint32_t paramVal1, uint32_t paramVal2)
 {
 	if (paramId < NUM_UI_PARAMS)
 	{
-		ADC_WORK_Suspend();
-
 		if ( (usingTransitionTime == 1) || (updateSmoothingTime == 1) )
 		{
 			SetAllTimes(smoothingTime);			// switching from transition smoothing to edit smoothing
@@ -817,220 +946,590 @@ void PARAM_Set2(uint32_t paramId, uint32_t paramVal1, uint32_t paramVal2)
 		{
 			SetMCAmount(paramId + 1, paramVal2);	// relying in the rule that the MC amount is located directly after the parameter to which it belongs
 		}
+	}
+}
 
-		ADC_WORK_Resume();
+
+
+/*****************************************************************************
+* @brief	ParamType - how a parameter of a preset has to be applied
+******************************************************************************/
+
+static uint32_t ParamType(uint32_t paramId)
+{
+	switch (paramId)
+	{
+		case PARAM_ID_PEDAL_1:					// the play controls
+		case PARAM_ID_PEDAL_2:
+		case PARAM_ID_PEDAL_3:
+		case PARAM_ID_PEDAL_4:
+		case PARAM_ID_PITCHBEND:
+		case PARAM_ID_AFTERTOUCH:
+		case PARAM_ID_RIBBON_1:
+		case PARAM_ID_RIBBON_2:
+			return PARAM_TYPE_PLAY_CONTROL;
+
+		case PARAM_ID_MACRO_CONTROL_A:			// the macro controls
+		case PARAM_ID_MACRO_CONTROL_B:
+		case PARAM_ID_MACRO_CONTROL_C:
+		case PARAM_ID_MACRO_CONTROL_D:
+			return PARAM_TYPE_MACRO_CONTROL;
+
+		case PARAM_ID_PEDAL_1_TO_MC_A:			// the play control amounts
+		case PARAM_ID_PEDAL_1_TO_MC_B:
+		case PARAM_ID_PEDAL_1_TO_MC_C:
+		case PARAM_ID_PEDAL_1_TO_MC_D:
+		case PARAM_ID_PEDAL_2_TO_MC_A:
+		case PARAM_ID_PEDAL_2_TO_MC_B:
+		case PARAM_ID_PEDAL_2_TO_MC_C:
+		case PARAM_ID_PEDAL_2_TO_MC_D:
+		case PARAM_ID_PEDAL_3_TO_MC_A:
+		case PARAM_ID_PEDAL_3_TO_MC_B:
+		case PARAM_ID_PEDAL_3_TO_MC_C:
+		case PARAM_ID_PEDAL_3_TO_MC_D:
+		case PARAM_ID_PEDAL_4_TO_MC_A:
+		case PARAM_ID_PEDAL_4_TO_MC_B:
+		case PARAM_ID_PEDAL_4_TO_MC_C:
+		case PARAM_ID_PEDAL_4_TO_MC_D:
+		case PARAM_ID_PITCHBEND_TO_MC_A:
+		case PARAM_ID_PITCHBEND_TO_MC_B:
+		case PARAM_ID_PITCHBEND_TO_MC_C:
+		case PARAM_ID_PITCHBEND_TO_MC_D:
+		case PARAM_ID_AFTERTOUCH_TO_MC_A:
+		case PARAM_ID_AFTERTOUCH_TO_MC_B:
+		case PARAM_ID_AFTERTOUCH_TO_MC_C:
+		case PARAM_ID_AFTERTOUCH_TO_MC_D:
+		case PARAM_ID_RIBBON_1_TO_MC_A:
+		case PARAM_ID_RIBBON_1_TO_MC_B:
+		case PARAM_ID_RIBBON_1_TO_MC_C:
+		case PARAM_ID_RIBBON_1_TO_MC_D:
+		case PARAM_ID_RIBBON_2_TO_MC_A:
+		case PARAM_ID_RIBBON_2_TO_MC_B:
+		case PARAM_ID_RIBBON_2_TO_MC_C:
+		case PARAM_ID_RIBBON_2_TO_MC_D:
+			return PARAM_TYPE_PC_AMOUNT;
+
+		case PARAM_ID_ENV_A_ATTACK_MC:			// the macro control amounts
+		case PARAM_ID_ENV_A_DECAY_1_MC:
+		case PARAM_ID_ENV_A_BREAKPOINT_MC:
+		case PARAM_ID_ENV_A_DECAY_2_MC:
+		case PARAM_ID_ENV_A_SUSTAIN_MC:
+		case PARAM_ID_ENV_A_RELEASE_MC:
+		case PARAM_ID_ENV_A_GAIN_MC:
+		case PARAM_ID_ENV_B_ATTACK_MC:
+		case PARAM_ID_ENV_B_DECAY_1_MC:
+		case PARAM_ID_ENV_B_BREAKPOINT_MC:
+		case PARAM_ID_ENV_B_DECAY_2_MC:
+		case PARAM_ID_ENV_B_SUSTAIN_MC:
+		case PARAM_ID_ENV_B_RELEASE_MC:
+		case PARAM_ID_ENV_B_GAIN_MC:
+		case PARAM_ID_ENV_C_ATTACK_MC:
+		case PARAM_ID_ENV_C_DECAY_1_MC:
+		case PARAM_ID_ENV_C_BREAKPOINT_MC:
+		case PARAM_ID_ENV_C_DECAY_2_MC:
+		case PARAM_ID_ENV_C_SUSTAIN_MC:
+		case PARAM_ID_ENV_C_RELEASE_MC:
+		case PARAM_ID_OSC_A_PITCH_MC:
+		case PARAM_ID_OSC_A_FLUCT_MC:
+		case PARAM_ID_OSC_A_PM_SELF_MC:
+		case PARAM_ID_OSC_A_PM_B_MC:
+		case PARAM_ID_OSC_A_PM_FB_MC:
+		case PARAM_ID_SHAPER_A_DRIVE_MC:
+		case PARAM_ID_SHAPER_A_MIX_MC:
+		case PARAM_ID_SHAPER_A_FB_MIX_MC:
+		case PARAM_ID_SHAPER_A_RING_MOD_MC:
+		case PARAM_ID_OSC_B_PITCH_MC:
+		case PARAM_ID_OSC_B_FLUCT_MC:
+		case PARAM_ID_OSC_B_PM_SELF_MC:
+		case PARAM_ID_OSC_B_PM_A_MC:
+		case PARAM_ID_OSC_B_PM_FB_MC:
+		case PARAM_ID_SHAPER_B_DRIVE_MC:
+		case PARAM_ID_SHAPER_B_MIX_MC:
+		case PARAM_ID_SHAPER_B_FB_MIX_MC:
+		case PARAM_ID_SHAPER_B_RING_MOD_MC:
+		case PARAM_ID_COMB_A_B_MC:
+		case PARAM_ID_COMB_PITCH_MC:
+		case PARAM_ID_COMB_DECAY_MC:
+		case PARAM_ID_COMB_DECAY_GATE_MC:
+		case PARAM_ID_COMB_AP_TUNE_MC:
+		case PARAM_ID_COMB_AP_RESON_MC:
+		case PARAM_ID_COMB_HI_CUT_MC:
+		case PARAM_ID_COMB_PM_MC:
+		case PARAM_ID_SVF_A_B_MC:
+		case PARAM_ID_SVF_COMB_MIX_MC:
+		case PARAM_ID_SVF_CUTOFF_MC:
+		case PARAM_ID_SVF_RESON_MC:
+		case PARAM_ID_SVF_SPREAD_MC:
+		case PARAM_ID_SVF_L_B_H_MC:
+		case PARAM_ID_SVF_FM_MC:
+		case PARAM_ID_FB_MIXER_COMB_MC:
+		case PARAM_ID_FB_MIXER_SVF_MC:
+		case PARAM_ID_FB_MIXER_EFFECTS_MC:
+		case PARAM_ID_FB_MIXER_REVERB_MC:
+		case PARAM_ID_FB_MIXER_DRIVE_MC:
+		case PARAM_ID_FB_MIXER_LEVEL_MC:
+		case PARAM_ID_OUT_MIXER_A_MC:
+		case PARAM_ID_OUT_MIXER_B_MC:
+		case PARAM_ID_OUT_MIXER_COMB_MC:
+		case PARAM_ID_OUT_MIXER_SVF_MC:
+		case PARAM_ID_OUT_MIXER_DRIVE_MC:
+		case PARAM_ID_OUT_MIXER_LEVEL_MC:
+		case PARAM_ID_CABINET_DRIVE_MC:
+		case PARAM_ID_CABINET_TILT_MC:
+		case PARAM_ID_CABINET_HI_CUT_MC:
+		case PARAM_ID_CABINET_LEVEL_MC:
+		case PARAM_ID_CABINET_MIX_MC:
+		case PARAM_ID_GAP_FILT_CENTER_MC:
+		case PARAM_ID_GAP_FILT_GAP_MC:
+		case PARAM_ID_GAP_FILT_BALANCE_MC:
+		case PARAM_ID_GAP_FILT_MIX_MC:
+		case PARAM_ID_FLANGER_T_MOD_MC:
+		case PARAM_ID_FLANGER_RATE_MC:
+		case PARAM_ID_FLANGER_TIME_MC:
+		case PARAM_ID_FLANGER_AP_MOD_MC:
+		case PARAM_ID_FLANGER_AP_TUNE_MC:
+		case PARAM_ID_FLANGER_FB_MC:
+		case PARAM_ID_FLANGER_MIX_MC:
+		case PARAM_ID_ECHO_TIME_MC:
+		case PARAM_ID_ECHO_STEREO_MC:
+		case PARAM_ID_ECHO_FB_MC:
+		case PARAM_ID_ECHO_MIX_MC:
+		case PARAM_ID_REVERB_SIZE_MC:
+		case PARAM_ID_REVERB_HI_CUT_MC:
+		case PARAM_ID_REVERB_MIX_MC:
+		case PARAM_ID_UNISON_DETUNE_MC:
+			return PARAM_TYPE_MC_AMOUNT;
+
+		case PARAM_ID_SCALE_BASE_KEY:
+			return PARAM_TYPE_SCALE_BASE;
+
+		case PARAM_ID_SCALE_OFFSET_1:
+		case PARAM_ID_SCALE_OFFSET_2:
+		case PARAM_ID_SCALE_OFFSET_3:
+		case PARAM_ID_SCALE_OFFSET_4:
+		case PARAM_ID_SCALE_OFFSET_5:
+		case PARAM_ID_SCALE_OFFSET_6:
+		case PARAM_ID_SCALE_OFFSET_7:
+		case PARAM_ID_SCALE_OFFSET_8:
+		case PARAM_ID_SCALE_OFFSET_9:
+		case PARAM_ID_SCALE_OFFSET_10:
+		case PARAM_ID_SCALE_OFFSET_11:
+			return PARAM_TYPE_SCALE_OFFSET;
+
+		default:
+			return PARAM_TYPE_BASIC;
 	}
 }
 
 
 
-void PARAM_ApplyPreset(uint16_t numParams, uint16_t* data)
+/*****************************************************************************
+* @brief	ApplyPresetParam - sets one parameter of a preset, called by RecallPreset
+*			and at the midpoint of a morph
+******************************************************************************/
+
+static void ApplyPresetParam(uint32_t paramId, uint32_t paramVal)
+{
+	switch (ParamType(paramId))
+	{
+		case PARAM_TYPE_PLAY_CONTROL:
+			break;									// we ignore them, because they can conflict with the state of the hardware sources
+
+		case PARAM_TYPE_MACRO_CONTROL:
+			paramValue[paramId] = (paramVal > 3200) ? 3200 : paramVal;	// only setting the variables, no processing!
+			modulatedValue[paramId] = paramValue[paramId] * 40000;  				// up-scaled for integer calculation of weighted increments of the play controls
+			break;
+
+		case PARAM_TYPE_PC_AMOUNT:
+			SetPCAmount(paramId, paramVal);
+			break;
+
+		case PARAM_TYPE_MC_AMOUNT:
+			if (paramVal != paramValue[paramId])
+			{
+				SetMCAmount(paramId, paramVal);
+			}
+			break;
+
+		case PARAM_TYPE_SCALE_BASE:
+			POLY_SetScaleBase(paramVal);					// 0: C, 1: C# ... 11: H
+			break;
+
+		case PARAM_TYPE_SCALE_OFFSET:
+			POLY_SetScaleOffset(paramId, paramVal);		// -8000: -800 Cent ... 8000: +800 Cent		/// Implizites Casting auf int16_t! Besser unser sign+abs verwenden?
+			break;
+
+		default:								// all basic parameters
+			ProcessBasicParamDirectly(paramId, paramVal);
+	}
+}
+
+
+
+void PARAM_ApplyPreset(uint16_t numParams, uint16_t* data, void (*callback)(void))
 {
 	if (numParams > NUM_UI_PARAMS)
 	{
 		numParams = NUM_UI_PARAMS;			/// Vielleicht ein Fall für eine Assertion ???
 	}
 
-	ADC_WORK_Suspend();
+	if (presetBusy == 0)					// a new preset replaces an unfinished one within the same preload bracket
+	{
+		ADC_WORK_Suspend();					// the hardware sources would modify a half-applied preset
+
+		if ( (usingTransitionTime == 0) || (updateTransitionTime == 1) )
+		{
+			SetAllTimes(transitionTime);				// switching from edit smoothing to transition smoothing
+
+			usingTransitionTime = 1;
+			updateTransitionTime = 0;
+		}
+
+		if (usingGlitchSuppression)
+		{
+			MSG_Reset(0);								// flushing the delays of the audio engine to avoid glitches
+		}
+
+		MSG_EnablePreload();
+	}
+
+	ClearDirtyParams();							// pending MC updates would overwrite the preset values
+
+	uint32_t i;
 
-	if ( (usingTransitionTime == 0) || (updateTransitionTime == 1) )
+	for (i = 0; i < numParams; i++)
 	{
-		SetAllTimes(transitionTime);				// switching from edit smoothing to transition smoothing
+		presetData[i] = data[i];
+	}
+
+	presetLength = numParams;
+	presetPos = 0;
+	presetCallback = callback;
+	presetBusy = 1;
+
+	morphSide = MORPH_SIDE_NONE;					// the next morph position sets the discrete parameters again
+}
+
+
+
+/*****************************************************************************
+* @brief	RecallPreset - applies the next presetBudget parameters of the preset,
+*			closes the preload bracket after the last one
+*			called by PARAM_WORK_Process while a recall is running
+******************************************************************************/
+
+static void RecallPreset(void)
+{
+	uint32_t end = presetPos + presetBudget;
 
-		usingTransitionTime = 1;
-		updateTransitionTime = 0;
+	if (end > presetLength)
+	{
+		end = presetLength;
 	}
 
-	if (usingGlitchSuppression)
+	while (presetPos < end)
 	{
-		MSG_Reset(0);								// flushing the delays of the audio engine to avoid glitches
+		ApplyPresetParam(presetPos, presetData[presetPos]);
+		presetPos++;
 	}
 
-	MSG_EnablePreload();
+	if (presetPos == presetLength)
+	{
+		presetBusy = 0;
+
+		ADC_WORK_Resume();
+
+		MSG_ApplyPreloadedValues();			/// war vorher kurz vor dem Fade-In
 
+		if (presetCallback)
+		{
+			presetCallback();
+		}
+	}
+}
+
+
+
+/*****************************************************************************
+* @brief	PARAM_PresetBusy - returns 1 while a preset recall is running
+******************************************************************************/
+
+uint32_t PARAM_PresetBusy(void)
+{
+	return presetBusy;
+}
+
+
+
+/*****************************************************************************
+* @brief	PARAM_SetPresetBudget - number of parameters applied per tick
+*			during a preset recall (1 ... NUM_UI_PARAMS)
+******************************************************************************/
+
+void PARAM_SetPresetBudget(uint32_t numParams)
+{
+	if (numParams == 0)
+	{
+		numParams = 1;
+	}
+	else if (numParams > NUM_UI_PARAMS)
+	{
+		numParams = NUM_UI_PARAMS;
+	}
+
+	presetBudget = numParams;
+}
+
+
+//======================= Morphing
+
+/*****************************************************************************
+* @brief	SetMorphImage - stores one of the two images, the values are applied
+*			with the next morph position
+******************************************************************************/
+
+static void SetMorphImage(uint32_t image, uint16_t length, uint16_t* data)
+{
+	if (length > NUM_UI_PARAMS)
+	{
+		length = NUM_UI_PARAMS;
+	}
+
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		morphImage[image][i] = data[i];
+	}
+
+	morphLength[image] = length;
+	morphSide = MORPH_SIDE_NONE;
+}
+
+
+void PARAM_SetMorphA(uint16_t length, uint16_t* data)
+{
+	SetMorphImage(0, length, data);
+}
+
+
+void PARAM_SetMorphB(uint16_t length, uint16_t* data)
+{
+	SetMorphImage(1, length, data);
+}
+
+
+
+/*****************************************************************************
+* @brief	PARAM_SetMorphPos - position between image A (0) and image B (16000)
+*			all positions received within a tick are applied once by PARAM_WORK_Process
+******************************************************************************/
+
+void PARAM_SetMorphPos(uint32_t pos)
+{
+	morphPos = (pos > 16000) ? 16000 : pos;
+	morphPending = 1;
+}
+
+
+
+/*****************************************************************************
+* @brief	IsDiscreteParam - basic parameters with steps or switch positions,
+*			which must not take intermediate values
+******************************************************************************/
+
+static uint32_t IsDiscreteParam(uint32_t paramId)
+{
+	switch (paramId)
+	{
+		case PARAM_ID_UNISON_VOICES:
+		case PARAM_ID_SVF_PARALLEL:
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+
+
+/*****************************************************************************
+* @brief	MorphValue - value of a basic parameter at a morph position
+******************************************************************************/
+
+static int32_t MorphValue(uint32_t paramId, uint32_t pos)
+{
+	uint32_t a = morphImage[0][paramId];
+	uint32_t b = morphImage[1][paramId];
+	int32_t valA = (a & 0x8000) ? -(int32_t)(a & 0x7FFF) : (int32_t)a;
+	int32_t valB = (b & 0x8000) ? -(int32_t)(b & 0x7FFF) : (int32_t)b;
+
+	return valA + ((valB - valA) * (int32_t)pos) / 16000;
+}
+
+
+
+/*****************************************************************************
+* @brief	ApplyMorph - interpolates the continuous basic parameters between
+*			the images and queues the changed ones for the flush; the
+*			discrete parameters (MCs, PC and MC amounts, scale, steps and
+*			switches) switch to image B at the midpoint
+*			The first position after loading an image or a preset sets the
+*			interpolated values, the following ones move them by the change of
+*			the interpolation, so the modulation by the MCs is kept.
+******************************************************************************/
+
+static void ApplyMorph(void)
+{
+	uint32_t length = (morphLength[0] < morphLength[1]) ? morphLength[0] : morphLength[1];
+
+	if (length == 0)
+	{
+		return;									// both images are needed
+	}
+
+	if ( (usingTransitionTime == 1) || (updateSmoothingTime == 1) )
+	{
+		SetAllTimes(smoothingTime);			// switching from transition smoothing to edit smoothing
+
+		usingTransitionTime = 0;
+		updateSmoothingTime = 0;
+	}
+
+	uint32_t side = (morphPos >= 8000) ? 1 : 0;
 	uint32_t paramId;
 
-	for (paramId = 0; paramId < numParams; paramId++)
+	for (paramId = 0; paramId < length; paramId++)
 	{
-		switch (paramId)
+		uint32_t a = morphImage[0][paramId];
+		uint32_t b = morphImage[1][paramId];
+
+		if ( (ParamType(paramId) == PARAM_TYPE_BASIC) && !IsDiscreteParam(paramId) )
 		{
-			case PARAM_ID_PEDAL_1:					// the play controls
-			case PARAM_ID_PEDAL_2:
-			case PARAM_ID_PEDAL_3:
-			case PARAM_ID_PEDAL_4:
-			case PARAM_ID_PITCHBEND:
-			case PARAM_ID_AFTERTOUCH:
-			case PARAM_ID_RIBBON_1:
-			case PARAM_ID_RIBBON_2:
-				break;									// we ignore them, because they can conflict with the state of the hardware sources
+			int32_t delta;
 
-			case PARAM_ID_MACRO_CONTROL_A:			// the macro controls
-			case PARAM_ID_MACRO_CONTROL_B:
-			case PARAM_ID_MACRO_CONTROL_C:
-			case PARAM_ID_MACRO_CONTROL_D:
-				modulatedValue[paramId] = data[paramId] * 40000;  	// up-scaled for integer calculation of weighted increments of the play controls
-				paramValue[paramId] = data[paramId];				// only setting the variables, no processing!
-				break;
+			if (morphSide == MORPH_SIDE_NONE)
+			{
+				delta = MorphValue(paramId, morphPos) - paramValue[paramId];
+			}
+			else
+			{
+				delta = MorphValue(paramId, morphPos) - MorphValue(paramId, morphLastPos);
+			}
 
-			case PARAM_ID_PEDAL_1_TO_MC_A:			// the play control amounts
-			case PARAM_ID_PEDAL_1_TO_MC_B:
-			case PARAM_ID_PEDAL_1_TO_MC_C:
-			case PARAM_ID_PEDAL_1_TO_MC_D:
-			case PARAM_ID_PEDAL_2_TO_MC_A:
-			case PARAM_ID_PEDAL_2_TO_MC_B:
-			case PARAM_ID_PEDAL_2_TO_MC_C:
-			case PARAM_ID_PEDAL_2_TO_MC_D:
-			case PARAM_ID_PEDAL_3_TO_MC_A:
-			case PARAM_ID_PEDAL_3_TO_MC_B:
-			case PARAM_ID_PEDAL_3_TO_MC_C:
-			case PARAM_ID_PEDAL_3_TO_MC_D:
-			case PARAM_ID_PEDAL_4_TO_MC_A:
-			case PARAM_ID_PEDAL_4_TO_MC_B:
-			case PARAM_ID_PEDAL_4_TO_MC_C:
-			case PARAM_ID_PEDAL_4_TO_MC_D:
-			case PARAM_ID_PITCHBEND_TO_MC_A:
-			case PARAM_ID_PITCHBEND_TO_MC_B:
-			case PARAM_ID_PITCHBEND_TO_MC_C:
-			case PARAM_ID_PITCHBEND_TO_MC_D:
-			case PARAM_ID_AFTERTOUCH_TO_MC_A:
-			case PARAM_ID_AFTERTOUCH_TO_MC_B:
-			case PARAM_ID_AFTERTOUCH_TO_MC_C:
-			case PARAM_ID_AFTERTOUCH_TO_MC_D:
-			case PARAM_ID_RIBBON_1_TO_MC_A:
-			case PARAM_ID_RIBBON_1_TO_MC_B:
-			case PARAM_ID_RIBBON_1_TO_MC_C:
-			case PARAM_ID_RIBBON_1_TO_MC_D:
-			case PARAM_ID_RIBBON_2_TO_MC_A:
-			case PARAM_ID_RIBBON_2_TO_MC_B:
-			case PARAM_ID_RIBBON_2_TO_MC_C:
-			case PARAM_ID_RIBBON_2_TO_MC_D:
-				SetPCAmount(paramId, data[paramId]);
-				break;
+			if (delta != 0)
+			{
+				int32_t val;
 
-			case PARAM_ID_ENV_A_ATTACK_MC:			// the macro control amounts
-			case PARAM_ID_ENV_A_DECAY_1_MC:
-			case PARAM_ID_ENV_A_BREAKPOINT_MC:
-			case PARAM_ID_ENV_A_DECAY_2_MC:
-			case PARAM_ID_ENV_A_SUSTAIN_MC:
-			case PARAM_ID_ENV_A_RELEASE_MC:
-			case PARAM_ID_ENV_A_GAIN_MC:
-			case PARAM_ID_ENV_B_ATTACK_MC:
-			case PARAM_ID_ENV_B_DECAY_1_MC:
-			case PARAM_ID_ENV_B_BREAKPOINT_MC:
-			case PARAM_ID_ENV_B_DECAY_2_MC:
-			case PARAM_ID_ENV_B_SUSTAIN_MC:
-			case PARAM_ID_ENV_B_RELEASE_MC:
-			case PARAM_ID_ENV_B_GAIN_MC:
-			case PARAM_ID_ENV_C_ATTACK_MC:
-			case PARAM_ID_ENV_C_DECAY_1_MC:
-			case PARAM_ID_ENV_C_BREAKPOINT_MC:
-			case PARAM_ID_ENV_C_DECAY_2_MC:
-			case PARAM_ID_ENV_C_SUSTAIN_MC:
-			case PARAM_ID_ENV_C_RELEASE_MC:
-			case PARAM_ID_OSC_A_PITCH_MC:
-			case PARAM_ID_OSC_A_FLUCT_MC:
-			case PARAM_ID_OSC_A_PM_SELF_MC:
-			case PARAM_ID_OSC_A_PM_B_MC:
-			case PARAM_ID_OSC_A_PM_FB_MC:
-			case PARAM_ID_SHAPER_A_DRIVE_MC:
-			case PARAM_ID_SHAPER_A_MIX_MC:
-			case PARAM_ID_SHAPER_A_FB_MIX_MC:
-			case PARAM_ID_SHAPER_A_RING_MOD_MC:
-			case PARAM_ID_OSC_B_PITCH_MC:
-			case PARAM_ID_OSC_B_FLUCT_MC:
-			case PARAM_ID_OSC_B_PM_SELF_MC:
-			case PARAM_ID_OSC_B_PM_A_MC:
-			case PARAM_ID_OSC_B_PM_FB_MC:
-			case PARAM_ID_SHAPER_B_DRIVE_MC:
-			case PARAM_ID_SHAPER_B_MIX_MC:
-			case PARAM_ID_SHAPER_B_FB_MIX_MC:
-			case PARAM_ID_SHAPER_B_RING_MOD_MC:
-			case PARAM_ID_COMB_A_B_MC:
-			case PARAM_ID_COMB_PITCH_MC:
-			case PARAM_ID_COMB_DECAY_MC:
-			case PARAM_ID_COMB_DECAY_GATE_MC:
-			case PARAM_ID_COMB_AP_TUNE_MC:
-			case PARAM_ID_COMB_AP_RESON_MC:
-			case PARAM_ID_COMB_HI_CUT_MC:
-			case PARAM_ID_COMB_PM_MC:
-			case PARAM_ID_SVF_A_B_MC:
-			case PARAM_ID_SVF_COMB_MIX_MC:
-			case PARAM_ID_SVF_CUTOFF_MC:
-			case PARAM_ID_SVF_RESON_MC:
-			case PARAM_ID_SVF_SPREAD_MC:
-			case PARAM_ID_SVF_L_B_H_MC:
-			case PARAM_ID_SVF_FM_MC:
-			case PARAM_ID_FB_MIXER_COMB_MC:
-			case PARAM_ID_FB_MIXER_SVF_MC:
-			case PARAM_ID_FB_MIXER_EFFECTS_MC:
-			case PARAM_ID_FB_MIXER_REVERB_MC:
-			case PARAM_ID_FB_MIXER_DRIVE_MC:
-			case PARAM_ID_FB_MIXER_LEVEL_MC:
-			case PARAM_ID_OUT_MIXER_A_MC:
-			case PARAM_ID_OUT_MIXER_B_MC:
-			case PARAM_ID_OUT_MIXER_COMB_MC:
-			case PARAM_ID_OUT_MIXER_SVF_MC:
-			case PARAM_ID_OUT_MIXER_DRIVE_MC:
-			case PARAM_ID_OUT_MIXER_LEVEL_MC:
-			case PARAM_ID_CABINET_DRIVE_MC:
-			case PARAM_ID_CABINET_TILT_MC:
-			case PARAM_ID_CABINET_HI_CUT_MC:
-			case PARAM_ID_CABINET_LEVEL_MC:
-			case PARAM_ID_CABINET_MIX_MC:
-			case PARAM_ID_GAP_FILT_CENTER_MC:
-			case PARAM_ID_GAP_FILT_GAP_MC:
-			case PARAM_ID_GAP_FILT_BALANCE_MC:
-			case PARAM_ID_GAP_FILT_MIX_MC:
-			case PARAM_ID_FLANGER_T_MOD_MC:
-			case PARAM_ID_FLANGER_RATE_MC:
-			case PARAM_ID_FLANGER_TIME_MC:
-			case PARAM_ID_FLANGER_AP_MOD_MC:
-			case PARAM_ID_FLANGER_AP_TUNE_MC:
-			case PARAM_ID_FLANGER_FB_MC:
-			case PARAM_ID_FLANGER_MIX_MC:
-			case PARAM_ID_ECHO_TIME_MC:
-			case PARAM_ID_ECHO_STEREO_MC:
-			case PARAM_ID_ECHO_FB_MC:
-			case PARAM_ID_ECHO_MIX_MC:
-			case PARAM_ID_REVERB_SIZE_MC:
-			case PARAM_ID_REVERB_HI_CUT_MC:
-			case PARAM_ID_REVERB_MIX_MC:
-			case PARAM_ID_UNISON_DETUNE_MC:
-				if (data[paramId] != paramValue[paramId])
-				{
-					SetMCAmount(paramId, data[paramId]);
-				}
-				break;
+				modulatedValue[paramId] += delta * maxMCAmount[paramId];		// up-scaled for integer calculation of weighted increments of the MC modulation
+				val = modulatedValue[paramId] / maxMCAmount[paramId];
 
-			case PARAM_ID_SCALE_BASE_KEY:
-				POLY_SetScaleBase(data[paramId]);					// 0: C, 1: C# ... 11: H
-				break;
+				if (val > maxValue[paramId])
+					val = maxValue[paramId];
+				else if (val < minValue[paramId])
+					val = minValue[paramId];
 
-			case PARAM_ID_SCALE_OFFSET_1:
-			case PARAM_ID_SCALE_OFFSET_2:
-			case PARAM_ID_SCALE_OFFSET_3:
-			case PARAM_ID_SCALE_OFFSET_4:
-			case PARAM_ID_SCALE_OFFSET_5:
-			case PARAM_ID_SCALE_OFFSET_6:
-			case PARAM_ID_SCALE_OFFSET_7:
-			case PARAM_ID_SCALE_OFFSET_8:
-			case PARAM_ID_SCALE_OFFSET_9:
-			case PARAM_ID_SCALE_OFFSET_10:
-			case PARAM_ID_SCALE_OFFSET_11:
-				POLY_SetScaleOffset(paramId, data[paramId]);		// -8000: -800 Cent ... 8000: +800 Cent		/// Implizites Casting auf int16_t! Besser unser sign+abs verwenden?
-				break;
+				QueueBasicParam(paramId, val);
+			}
+		}
+		else if ( (side != morphSide) && ((a != b) || (morphSide == MORPH_SIDE_NONE)) )
+		{
+			ApplyPresetParam(paramId, morphImage[side][paramId]);
+		}
+	}
+
+	morphLastPos = morphPos;
+	morphSide = side;
+}
+
+
+//======================= Coalescing stage
+
+/*****************************************************************************
+* @brief	PARAM_WORK_Process - sends the parameters changed by MCs and play controls,
+*			or applies the next part of a preset while a recall is running
+*			since the last call, each parameter at most once and with its latest value
+*			targets with a minimum update interval stay in the list until it has passed
+*			COOS task, every 125 us
+******************************************************************************/
+
+void PARAM_WORK_Process(void)
+{
+	uint32_t budget = PARAM_FLUSH_BUDGET;
+	uint32_t numKept = 0;
+	uint32_t i;
+
+	if (presetBusy)
+	{
+		RecallPreset();						// the flush is held until the preset is complete
+		return;
+	}
+
+	if (morphPending)
+	{
+		morphPending = 0;
+		ApplyMorph();
+	}
+
+	flushTick++;
+
+	for (i = 0; i < numDirty; i++)
+	{
+		uint32_t paramId = dirtyParam[i];
 
-			default:								// all basic parameters
-				ProcessBasicParamDirectly(paramId, data[paramId]);
+		if (dirtyState[paramId] == DIRTY_CANCELED)
+		{
+			dirtyState[paramId] = DIRTY_NONE;				// already sent directly
+		}
+		else if ( (budget == 0) || ((flushTick - lastUpdateTick[paramId]) < minUpdateInterval[paramId]) )
+		{
+			dirtyParam[numKept] = paramId;					// waiting for the next flush
+			numKept++;
+		}
+		else
+		{
+			SendBasicParam(paramId, paramValue[paramId]);
+
+			dirtyState[paramId] = DIRTY_NONE;
+			lastUpdateTick[paramId] = flushTick;
+			budget--;
 		}
 	}
 
-	ADC_WORK_Resume();
+	numDirty = numKept;
+}
+
+
+/*****************************************************************************
+* @brief	PARAM_SetUpdateInterval - minimum time between two MC updates of a parameter
+* @param	paramId: target parameter, NUM_UI_PARAMS for all parameters
+* @param	ticks: 0 ... 65535 [125 us], 0: with every flush
+******************************************************************************/
+
+void PARAM_SetUpdateInterval(uint32_t paramId, uint32_t ticks)
+{
+	if (ticks > 0xFFFF)
+	{
+		ticks = 0xFFFF;
+	}
+
+	if (paramId < NUM_UI_PARAMS)
+	{
+		minUpdateInterval[paramId] = ticks;
+	}
+	else if (paramId == NUM_UI_PARAMS)
+	{
+		uint32_t i;
 
-	MSG_ApplyPreloadedValues();			/// war vorher kurz vor dem Fade-In
+		for (i = 0; i < NUM_UI_PARAMS; i++)
+		{
+			minUpdateInterval[i] = ticks;
+		}
+	}
 }
 
 
+
 //======================= Entry points for setting messages
 
 
@@ -422,14 +422,22 @@
 //======== public functions
 
 void PARAM_WORK_Init(void);
+void PARAM_WORK_Process(void);
 
 void PARAM_Set(uint32_t paramId, uint32_t paramVal);
 void PARAM_Set2(uint32_t paramId, uint32_t paramVal1, uint32_t paramVal2);
-void PARAM_ApplyPreset(uint16_t length, uint16_t* data);
+void PARAM_ApplyPreset(uint16_t length, uint16_t* data, void (*callback)(void));
+uint32_t PARAM_PresetBusy(void);
+void PARAM_SetPresetBudget(uint32_t numParams);
+
+void PARAM_SetMorphA(uint16_t length, uint16_t* data);
+void PARAM_SetMorphB(uint16_t length, uint16_t* data);
+void PARAM_SetMorphPos(uint32_t pos);
 
 void PARAM_SetTransitionTime(uint32_t time);
 void PARAM_SetEditSmoothingTime(uint32_t time);
 void PARAM_SetGlitchSuppression(uint32_t mode);
+void PARAM_SetUpdateInterval(uint32_t paramId, uint32_t ticks);
 
 void PARAM_SetNoteShift(uint32_t shift);
 
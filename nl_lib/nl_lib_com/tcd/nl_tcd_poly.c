@@ -5,9 +5,8 @@
  *      Author: ssc
  */
 
-#include "math.h"
-
 #include "nl_tcd_poly.h"
+#include "nl_tcd_tables.h"
 
 #include "nl_tcd_param_work.h"
 #include "nl_tcd_msg.h"
@@ -21,53 +20,29 @@ static int32_t e_UnisonVoices;
 static uint32_t e_ScaleBase;
 static int16_t e_ScaleOffset[12];
 
-static uint32_t velTable[65] = {};									// converts time difference (timeInUs) to velocities
+static const uint32_t* velTable = VEL_TABLE[VEL_CURVE_NORMAL];		// converts time difference (timeInUs) to velocities
 																	// element  0: shortest timeInUs   (2500 us or lower) -> 4096 = max. velocity
 																	// element 64: longest timeInUs (526788 us or higher) -> 0    = min. velocity
 
 
 /*******************************************************************************
-@brief  	ENV_Generate_VelTable - generates the elements of velTable[]
-@param[in]	curve - selects one of the five verlocity curves
+@brief  	POLY_Select_VelTable - selects one of the precomputed velocity curves
+@param[in]	curve - selects one of the five velocity curves
 			table index: 0 ... 64 (shortest ... longest key-switch time)
 			table values: 4096 ... 0
+			the tables are generated at build time (nl_tcd_tables.c)
 *******************************************************************************/
 
-void POLY_Generate_VelTable(uint32_t curve)
+void POLY_Select_VelTable(uint32_t curve)
 {
-	float_t vel_max = 4096.0;	// the hyperbola goes from vel_max (at 0) to 0 (at i_max)
-
-	float_t b = 0.5;
-
-	switch (curve)	// b defines the curve shape
+	if (curve < NUM_VEL_CURVES)
 	{
-		case VEL_CURVE_VERY_SOFT:
-			b = 0.125;
-			break;
-		case VEL_CURVE_SOFT:
-			b = 0.25;
-			break;
-		case VEL_CURVE_NORMAL:
-			b = 0.5;
-			break;
-		case VEL_CURVE_HARD:
-			b = 1.0;
-			break;
-		case VEL_CURVE_VERY_HARD:
-			b = 2.0;
-			break;
-		default:
-			/// Error
-			break;
+		velTable = VEL_TABLE[curve];
 	}
-
-	uint32_t i_max = 64;
-
-	uint32_t i;
-
-	for (i = 0; i <= i_max; i++)
+	else
 	{
-		velTable[i] = (uint32_t)( ( vel_max + vel_max / (b * i_max) ) / (1.0 + b * i) - vel_max / (b * i_max) + 0.5 );
+		velTable = VEL_TABLE[VEL_CURVE_NORMAL];
+		/// Error
 	}
 }
 
@@ -94,7 +69,7 @@ void POLY_Init(void)
 		e_ScaleOffset[i] = 0;			// e_ScaleOffset[0] bleibt immer Null (base key)
 	}
 
-	POLY_Generate_VelTable(VEL_CURVE_NORMAL);
+	POLY_Select_VelTable(VEL_CURVE_NORMAL);
 }
 
 
@@ -22,7 +22,7 @@
 
 //======== public functions
 
-void POLY_Generate_VelTable(uint32_t curve);
+void POLY_Select_VelTable(uint32_t curve);
 
 void POLY_Init(void);
 
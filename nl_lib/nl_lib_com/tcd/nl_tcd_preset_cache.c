@@ -0,0 +1,182 @@
+/*
+ * nl_tcd_preset_cache.c
+ *
+ *  Created on: 19.10.2026
+ *      Author: ssc
+ *
+ *  The BB stores presets of a set-list with BB_MSG_TYPE_PRESET_STORE and
+ *  recalls them with BB_MSG_TYPE_PRESET_RECALL (Id + checksum) instead of
+ *  sending the complete preset. The least recently used slot is replaced.
+ */
+
+
+#include "tcd/nl_tcd_preset_cache.h"
+#include "tcd/nl_tcd_param_work.h"
+
+
+typedef struct
+{
+	uint16_t presetId;
+	uint16_t checksum;
+	uint16_t length;							// 0: empty slot
+	uint32_t lastUse;							// value of useCounter at the last store or hit
+	uint16_t data[NUM_UI_PARAMS];
+} PRESET_SLOT_T;
+
+static PRESET_SLOT_T slot[PRESET_CACHE_SLOTS];
+
+static uint32_t useCounter;
+static uint32_t hits;
+static uint32_t misses;
+
+
+
+/*****************************************************************************
+* @brief	PRESET_CACHE_Init - empties all slots and resets the counters
+******************************************************************************/
+
+void PRESET_CACHE_Init(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < PRESET_CACHE_SLOTS; i++)
+	{
+		slot[i].length = 0;
+		slot[i].lastUse = 0;
+	}
+
+	useCounter = 0;
+	hits = 0;
+	misses = 0;
+}
+
+
+
+/*****************************************************************************
+* @brief	PRESET_CACHE_Checksum - Fletcher-16 over the bytes of the preset,
+*			low byte of each word first (the BB calculates the same)
+******************************************************************************/
+
+uint16_t PRESET_CACHE_Checksum(uint16_t length, uint16_t* data)
+{
+	uint32_t sum1 = 0;
+	uint32_t sum2 = 0;
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		sum1 = (sum1 + (data[i] & 0xFF)) % 255;
+		sum2 = (sum2 + sum1) % 255;
+
+		sum1 = (sum1 + (data[i] >> 8)) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (sum2 << 8) | sum1;
+}
+
+
+
+/*****************************************************************************
+* @brief	PRESET_CACHE_Store - stores a preset in the slot with the same Id,
+*			an empty slot or the least recently used slot
+* @return	number of the slot, -1 if the preset is too long
+******************************************************************************/
+
+int32_t PRESET_CACHE_Store(uint16_t presetId, uint16_t length, uint16_t* data)
+{
+	if ( (length == 0) || (length > NUM_UI_PARAMS) )
+	{
+		return -1;
+	}
+
+	uint32_t s;
+	uint32_t found = PRESET_CACHE_SLOTS;
+	uint32_t oldest = 0;
+
+	for (s = 0; s < PRESET_CACHE_SLOTS; s++)
+	{
+		if ( (slot[s].length != 0) && (slot[s].presetId == presetId) )
+		{
+			found = s;									// replacing the old version of the preset
+			break;
+		}
+
+		if (slot[s].length == 0)
+		{
+			if (found == PRESET_CACHE_SLOTS)
+			{
+				found = s;								// first empty slot, still looking for the Id
+			}
+		}
+		else if (slot[s].lastUse < slot[oldest].lastUse)
+		{
+			oldest = s;									// only used if all slots are in use
+		}
+	}
+
+	if (found == PRESET_CACHE_SLOTS)
+	{
+		found = oldest;									// all slots in use: evicting the least recently used one
+	}
+
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		slot[found].data[i] = data[i];
+	}
+
+	useCounter++;
+
+	slot[found].presetId = presetId;
+	slot[found].checksum = PRESET_CACHE_Checksum(length, data);
+	slot[found].length = length;
+	slot[found].lastUse = useCounter;
+
+	return found;
+}
+
+
+
+/*****************************************************************************
+* @brief	PRESET_CACHE_Find - looks for a preset with the given Id and checksum
+* @param	length: returns the number of parameters of the preset
+* @return	pointer to the preset, 0 on a miss (unknown Id or different checksum)
+******************************************************************************/
+
+uint16_t* PRESET_CACHE_Find(uint16_t presetId, uint16_t checksum, uint16_t* length)
+{
+	uint32_t s;
+
+	for (s = 0; s < PRESET_CACHE_SLOTS; s++)
+	{
+		if ( (slot[s].length != 0) && (slot[s].presetId == presetId) && (slot[s].checksum == checksum) )
+		{
+			useCounter++;
+			slot[s].lastUse = useCounter;
+			hits++;
+
+			*length = slot[s].length;
+
+			return slot[s].data;
+		}
+	}
+
+	misses++;
+
+	return 0;
+}
+
+
+
+uint32_t PRESET_CACHE_GetHits(void)
+{
+	return hits;
+}
+
+
+uint32_t PRESET_CACHE_GetMisses(void)
+{
+	return misses;
+}
@@ -0,0 +1,34 @@
+/*
+ * nl_tcd_preset_cache.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ssc
+ *
+ *  presets stored in SRAM of the LPC, recalled by the BB with their Id and checksum
+ */
+
+#ifndef NL_TCD_PRESET_CACHE_H_
+#define NL_TCD_PRESET_CACHE_H_
+
+
+#include "stdint.h"
+
+
+//======== defines
+
+#define PRESET_CACHE_SLOTS		8			// 8 * 648 bytes
+
+
+//======== public functions
+
+void PRESET_CACHE_Init(void);
+
+uint16_t PRESET_CACHE_Checksum(uint16_t length, uint16_t* data);
+
+int32_t PRESET_CACHE_Store(uint16_t presetId, uint16_t length, uint16_t* data);
+uint16_t* PRESET_CACHE_Find(uint16_t presetId, uint16_t checksum, uint16_t* length);
+
+uint32_t PRESET_CACHE_GetHits(void);
+uint32_t PRESET_CACHE_GetMisses(void);
+
+#endif /* NL_TCD_PRESET_CACHE_H_ */
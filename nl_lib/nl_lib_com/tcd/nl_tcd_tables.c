@@ -0,0 +1,385 @@
+/*
+ * nl_tcd_tables.c
+ *
+ *  generated by tools/tcd_tables/gen_tcd_tables.c - do not edit
+ */
+
+#include "nl_tcd_tables.h"
+
+
+const uint32_t EXPON_LIN_SLOPE = 9078269;
+
+#if (EXPON_SEGMENT_SHIFT == 4)
+
+const uint32_t EXPON_TABLE[1001] =
+{
+	19661,	19898,	20138,	20380,	20626,	20875,	21126,	21381,
+	21639,	21900,	22164,	22431,	22701,	22975,	23252,	23532,
+	23816,	24103,	24394,	24688,	24985,	25286,	25591,	25900,
+	26212,	26528,	26848,	27171,	27499,	27831,	28166,	28506,
+	28849,	29197,	29549,	29905,	30266,	30631,	31000,	31373,
+	31752,	32134,	32522,	32914,	33311,	33712,	34119,	34530,
+	34946,	35367,	35794,	36225,	36662,	37104,	37551,	38004,
+	38462,	38926,	39395,	39870,	40351,	40837,	41329,	41827,
+	42332,	42842,	43358,	43881,	44410,	44945,	45487,	46036,
+	46591,	47152,	47721,	48296,	48878,	49467,	50064,	50667,
+	51278,	51896,	52522,	53155,	53796,	54444,	55101,	55765,
+	56437,	57117,	57806,	58503,	59208,	59922,	60644,	61375,
+	62115,	62864,	63622,	64389,	65165,	65950,	66746,	67550,
+	68364,	69189,	70023,	70867,	71721,	72586,	73461,	74346,
+	75243,	76150,	77068,	77997,	78937,	79888,	80851,	81826,
+	82813,	83811,	84821,	85844,	86879,	87926,	88986,	90059,
+	91144,	92243,	93355,	94480,	95619,	96772,	97939,	99119,
+	100314,	101523,	102747,	103986,	105239,	106508,	107792,	109092,
+	110407,	111738,	113085,	114448,	115827,	117224,	118637,	120067,
+	121515,	122979,	124462,	125962,	127481,	129018,	130573,	132147,
+	133740,	135352,	136984,	138635,	140306,	141998,	143710,	145442,
+	147195,	148970,	150766,	152583,	154422,	156284,	158168,	160075,
+	162004,	163957,	165934,	167934,	169959,	172008,	174081,	176180,
+	178304,	180453,	182628,	184830,	187058,	189313,	191595,	193905,
+	196242,	198608,	201002,	203425,	205878,	208360,	210871,	213413,
+	215986,	218590,	221225,	223892,	226591,	229322,	232087,	234885,
+	237716,	240582,	243482,	246417,	249388,	252394,	255437,	258516,
+	261633,	264787,	267979,	271209,	274478,	277787,	281136,	284525,
+	287955,	291426,	294940,	298495,	302093,	305735,	309421,	313151,
+	316926,	320746,	324613,	328526,	332487,	336495,	340551,	344657,
+	348811,	353016,	357272,	361579,	365938,	370349,	374814,	379332,
+	383905,	388533,	393217,	397957,	402754,	407609,	412523,	417496,
+	422529,	427623,	432778,	437995,	443275,	448619,	454027,	459500,
+	465039,	470645,	476319,	482061,	487872,	493753,	499706,	505730,
+	511826,	517996,	524241,	530560,	536956,	543429,	549980,	556610,
+	563320,	570111,	576984,	583939,	590979,	598103,	605313,	612610,
+	619995,	627469,	635034,	642689,	650437,	658278,	666213,	674244,
+	682372,	690598,	698923,	707349,	715876,	724506,	733240,	742079,
+	751025,	760079,	769241,	778515,	787900,	797398,	807010,	816739,
+	826585,	836549,	846634,	856840,	867169,	877623,	888203,	898910,
+	909746,	920713,	931812,	943045,	954414,	965919,	977564,	989348,
+	1001275,	1013345,	1025561,	1037924,	1050436,	1063099,	1075915,	1088885,
+	1102012,	1115296,	1128741,	1142348,	1156119,	1170056,	1184161,	1198437,
+	1212884,	1227505,	1242303,	1257279,	1272435,	1287774,	1303298,	1319010,
+	1334910,	1351003,	1367289,	1383772,	1400453,	1417336,	1434422,	1451714,
+	1469214,	1486925,	1504850,	1522991,	1541351,	1559932,	1578737,	1597769,
+	1617030,	1636523,	1656251,	1676218,	1696424,	1716875,	1737572,	1758518,
+	1779717,	1801172,	1822885,	1844860,	1867100,	1889607,	1912387,	1935441,
+	1958772,	1982385,	2006283,	2030469,	2054946,	2079718,	2104790,	2130163,
+	2155842,	2181831,	2208133,	2234752,	2261692,	2288956,	2316550,	2344476,
+	2372738,	2401342,	2430290,	2459587,	2489238,	2519245,	2549615,	2580351,
+	2611457,	2642938,	2674799,	2707043,	2739677,	2772704,	2806128,	2839956,
+	2874192,	2908841,	2943907,	2979395,	3015312,	3051662,	3088450,	3125681,
+	3163361,	3201495,	3240089,	3279149,	3318679,	3358686,	3399175,	3440152,
+	3481623,	3523594,	3566071,	3609060,	3652567,	3696599,	3741161,	3786261,
+	3831904,	3878098,	3924849,	3972163,	4020047,	4068509,	4117555,	4167192,
+	4217428,	4268269,	4319723,	4371797,	4424499,	4477837,	4531817,	4586448,
+	4641738,	4697694,	4754325,	4811638,	4869642,	4928346,	4987757,	5047885,
+	5108737,	5170323,	5232651,	5295731,	5359571,	5424181,	5489569,	5555746,
+	5622721,	5690503,	5759102,	5828528,	5898791,	5969901,	6041868,	6114703,
+	6188416,	6263017,	6338518,	6414929,	6492261,	6570525,	6649733,	6729895,
+	6811024,	6893131,	6976228,	7060327,	7145439,	7231577,	7318754,	7406982,
+	7496273,	7586641,	7678098,	7770657,	7864333,	7959137,	8055085,	8152189,
+	8250464,	8349923,	8450581,	8552453,	8655553,	8759896,	8865497,	8972370,
+	9080532,	9189998,	9300784,	9412905,	9526378,	9641218,	9757443,	9875069,
+	9994113,	10114593,	10236524,	10359925,	10484814,	10611209,	10739127,	10868588,
+	10999609,	11132209,	11266408,	11402225,	11539679,	11678790,	11819577,	11962063,
+	12106265,	12252207,	12399907,	12549388,	12700671,	12853778,	13008730,	13165551,
+	13324262,	13484886,	13647446,	13811966,	13978470,	14146980,	14317522,	14490120,
+	14664799,	14841583,	15020499,	15201571,	15384826,	15570290,	15757990,	15947953,
+	16140206,	16334776,	16531692,	16730982,	16932674,	17136798,	17343382,	17552457,
+	17764052,	17978198,	18194925,	18414265,	18636249,	18860909,	19088278,	19318387,
+	19551271,	19786962,	20025494,	20266901,	20511219,	20758482,	21008726,	21261986,
+	21518300,	21777703,	22040233,	22305929,	22574827,	22846967,	23122387,	23401128,
+	23683229,	23968730,	24257674,	24550100,	24846052,	25145571,	25448702,	25755486,
+	26065969,	26380194,	26698208,	27020055,	27345782,	27675436,	28009064,	28346713,
+	28688433,	29034273,	29384281,	29738509,	30097007,	30459827,	30827020,	31198640,
+	31574740,	31955374,	32340597,	32730463,	33125029,	33524352,	33928488,	34337497,
+	34751436,	35170365,	35594344,	36023434,	36457697,	36897195,	37341991,	37792149,
+	38247734,	38708811,	39175446,	39647706,	40125660,	40609375,	41098922,	41594370,
+	42095790,	42603256,	43116838,	43636613,	44162652,	44695034,	45233833,	45779127,
+	46330995,	46889516,	47454770,	48026837,	48605801,	49191745,	49784752,	50384908,
+	50992299,	51607011,	52229134,	52858757,	53495970,	54140865,	54793534,	55454070,
+	56122570,	56799128,	57483842,	58176811,	58878133,	59587909,	60306242,	61033235,
+	61768991,	62513617,	63267220,	64029907,	64801788,	65582974,	66373578,	67173712,
+	67983492,	68803034,	69632455,	70471875,	71321415,	72181195,	73051340,	73931975,
+	74823226,	75725221,	76638089,	77561962,	78496973,	79443255,	80400944,	81370178,
+	82351097,	83343840,	84348551,	85365374,	86394455,	87435941,	88489982,	89556730,
+	90636338,	91728960,	92834753,	93953877,	95086493,	96232761,	97392848,	98566920,
+	99755146,	100957695,	102174742,	103406459,	104653025,	105914619,	107191421,	108483615,
+	109791386,	111114923,	112454414,	113810054,	115182035,	116570556,	117975815,	119398015,
+	120837360,	122294056,	123768312,	125260340,	126770355,	128298573,	129845214,	131410500,
+	132994655,	134597907,	136220487,	137862626,	139524562,	141206532,	142908779,	144631546,
+	146375081,	148139634,	149925459,	151732812,	153561953,	155413144,	157286652,	159182744,
+	161101694,	163043777,	165009272,	166998460,	169011629,	171049066,	173111065,	175197921,
+	177309934,	179447407,	181610648,	183799966,	186015677,	188258098,	190527552,	192824364,
+	195148864,	197501386,	199882267,	202291850,	204730481,	207198509,	209696290,	212224181,
+	214782546,	217371752,	219992172,	222644180,	225328158,	228044492,	230793571,	233575790,
+	236391549,	239241252,	242125308,	245044132,	247998142,	250987762,	254013423,	257075558,
+	260174607,	263311015,	266485232,	269697715,	272948924,	276239326,	279569395,	282939607,
+	286350448,	289802406,	293295977,	296831664,	300409973,	304031419,	307696521,	311405807,
+	315159807,	318959063,	322804118,	326695525,	330633844,	334619639,	338653483,	342735954,
+	346867640,	351049134,	355281036,	359563953,	363898500,	368285301,	372724985,	377218189,
+	381765559,	386367747,	391025415,	395739231,	400509873,	405338024,	410224379,	415169638,
+	420174513,	425239722,	430365992,	435554059,	440804669,	446118574,	451496539,	456939335,
+	462447745,	468022558,	473664575,	479374607,	485153474,	491002005,	496921040,	502911429,
+	508974033,	515109721,	521319374,	527603886,	533964157,	540401101,	546915643,	553508718,
+	560181272,	566934264,	573768663,	580685451,	587685622,	594770179,	601940140,	609196536,
+	616540408,	623972810,	631494809,	639107487,	646811935,	654609261,	662500584,	670487036,
+	678569765,	686749932,	695028711,	703407290,	711886873,	720468678,	729153937,	737943896,
+	746839819,	755842982,	764954678,	774176216,	783508920,	792954129,	802513201,	812187507,
+	821978437,	831887397,	841915809,	852065115,	862336770,	872732250,	883253048,	893900674,
+	904676657,	915582545,	926619904,	937790318,	949095391,	960536748,	972116030,	983834900,
+	995695042,	1007698158,	1019845971,	1032140226,	1044582689,	1057175146,	1069919405,	1082817297,
+	1095870672,	1109081406,	1122451396,	1135982561,	1149676844,	1163536213,	1177562656,	1191758188,
+	1206124847,	1220664696,	1235379824,	1250272343,	1265344391,	1280598133,	1296035758,	1311659485,
+	1327471556,	1343474242,	1359669840,	1376060676,	1392649104,	1409437506,	1426428292,	1443623902,
+	1461026805,	1478639501,	1496464518,	1514504416,	1532761785,	1551239246,	1569939454,	1588865093,
+	1608018881,	1627403568,	1647021938,	1666876807,	1686971027,	1707307483,	1727889095,	1748718819,
+	1769799645,	1791134601,	1812726750,	1834579193,	1856695067,	1879077549,	1901729851,	1924655227,
+	1947856969,	1971338408,	1995102917,	2019153906,	2043494831,	2068129186,	2093060508,	2118292377,
+	2143828418,	2169672295,	2195827721,	2222298450,	2249088285,	2276201071,	2303640702,	2331411119,
+	2359516308,	2387960305,	2416747195,	2445881112,	2475366238,	2505206808,	2535407106,	2565971469,
+	2596904286,	2628209998,	2659893102,	2691958145,	2724409733,	2757252525,	2790491237,	2824130642,
+	2858175571,	2892630912,	2927501613,	2962792680,	2998509181,	3034656245,	3071239063,	3108262887,
+	3145733033
+};
+
+#elif (EXPON_SEGMENT_SHIFT == 5)
+
+const uint32_t EXPON_TABLE[501] =
+{
+	19661,	20138,	20626,	21126,	21639,	22164,	22701,	23252,
+	23816,	24394,	24985,	25591,	26212,	26848,	27499,	28166,
+	28849,	29549,	30266,	31000,	31752,	32522,	33311,	34119,
+	34946,	35794,	36662,	37551,	38462,	39395,	40351,	41329,
+	42332,	43358,	44410,	45487,	46591,	47721,	48878,	50064,
+	51278,	52522,	53796,	55101,	56437,	57806,	59208,	60644,
+	62115,	63622,	65165,	66746,	68364,	70023,	71721,	73461,
+	75243,	77068,	78937,	80851,	82813,	84821,	86879,	88986,
+	91144,	93355,	95619,	97939,	100314,	102747,	105239,	107792,
+	110407,	113085,	115827,	118637,	121515,	124462,	127481,	130573,
+	133740,	136984,	140306,	143710,	147195,	150766,	154422,	158168,
+	162004,	165934,	169959,	174081,	178304,	182628,	187058,	191595,
+	196242,	201002,	205878,	210871,	215986,	221225,	226591,	232087,
+	237716,	243482,	249388,	255437,	261633,	267979,	274478,	281136,
+	287955,	294940,	302093,	309421,	316926,	324613,	332487,	340551,
+	348811,	357272,	365938,	374814,	383905,	393217,	402754,	412523,
+	422529,	432778,	443275,	454027,	465039,	476319,	487872,	499706,
+	511826,	524241,	536956,	549980,	563320,	576984,	590979,	605313,
+	619995,	635034,	650437,	666213,	682372,	698923,	715876,	733240,
+	751025,	769241,	787900,	807010,	826585,	846634,	867169,	888203,
+	909746,	931812,	954414,	977564,	1001275,	1025561,	1050436,	1075915,
+	1102012,	1128741,	1156119,	1184161,	1212884,	1242303,	1272435,	1303298,
+	1334910,	1367289,	1400453,	1434422,	1469214,	1504850,	1541351,	1578737,
+	1617030,	1656251,	1696424,	1737572,	1779717,	1822885,	1867100,	1912387,
+	1958772,	2006283,	2054946,	2104790,	2155842,	2208133,	2261692,	2316550,
+	2372738,	2430290,	2489238,	2549615,	2611457,	2674799,	2739677,	2806128,
+	2874192,	2943907,	3015312,	3088450,	3163361,	3240089,	3318679,	3399175,
+	3481623,	3566071,	3652567,	3741161,	3831904,	3924849,	4020047,	4117555,
+	4217428,	4319723,	4424499,	4531817,	4641738,	4754325,	4869642,	4987757,
+	5108737,	5232651,	5359571,	5489569,	5622721,	5759102,	5898791,	6041868,
+	6188416,	6338518,	6492261,	6649733,	6811024,	6976228,	7145439,	7318754,
+	7496273,	7678098,	7864333,	8055085,	8250464,	8450581,	8655553,	8865497,
+	9080532,	9300784,	9526378,	9757443,	9994113,	10236524,	10484814,	10739127,
+	10999609,	11266408,	11539679,	11819577,	12106265,	12399907,	12700671,	13008730,
+	13324262,	13647446,	13978470,	14317522,	14664799,	15020499,	15384826,	15757990,
+	16140206,	16531692,	16932674,	17343382,	17764052,	18194925,	18636249,	19088278,
+	19551271,	20025494,	20511219,	21008726,	21518300,	22040233,	22574827,	23122387,
+	23683229,	24257674,	24846052,	25448702,	26065969,	26698208,	27345782,	28009064,
+	28688433,	29384281,	30097007,	30827020,	31574740,	32340597,	33125029,	33928488,
+	34751436,	35594344,	36457697,	37341991,	38247734,	39175446,	40125660,	41098922,
+	42095790,	43116838,	44162652,	45233833,	46330995,	47454770,	48605801,	49784752,
+	50992299,	52229134,	53495970,	54793534,	56122570,	57483842,	58878133,	60306242,
+	61768991,	63267220,	64801788,	66373578,	67983492,	69632455,	71321415,	73051340,
+	74823226,	76638089,	78496973,	80400944,	82351097,	84348551,	86394455,	88489982,
+	90636338,	92834753,	95086493,	97392848,	99755146,	102174742,	104653025,	107191421,
+	109791386,	112454414,	115182035,	117975815,	120837360,	123768312,	126770355,	129845214,
+	132994655,	136220487,	139524562,	142908779,	146375081,	149925459,	153561953,	157286652,
+	161101694,	165009272,	169011629,	173111065,	177309934,	181610648,	186015677,	190527552,
+	195148864,	199882267,	204730481,	209696290,	214782546,	219992172,	225328158,	230793571,
+	236391549,	242125308,	247998142,	254013423,	260174607,	266485232,	272948924,	279569395,
+	286350448,	293295977,	300409973,	307696521,	315159807,	322804118,	330633844,	338653483,
+	346867640,	355281036,	363898500,	372724985,	381765559,	391025415,	400509873,	410224379,
+	420174513,	430365992,	440804669,	451496539,	462447745,	473664575,	485153474,	496921040,
+	508974033,	521319374,	533964157,	546915643,	560181272,	573768663,	587685622,	601940140,
+	616540408,	631494809,	646811935,	662500584,	678569765,	695028711,	711886873,	729153937,
+	746839819,	764954678,	783508920,	802513201,	821978437,	841915809,	862336770,	883253048,
+	904676657,	926619904,	949095391,	972116030,	995695042,	1019845971,	1044582689,	1069919405,
+	1095870672,	1122451396,	1149676844,	1177562656,	1206124847,	1235379824,	1265344391,	1296035758,
+	1327471556,	1359669840,	1392649104,	1426428292,	1461026805,	1496464518,	1532761785,	1569939454,
+	1608018881,	1647021938,	1686971027,	1727889095,	1769799645,	1812726750,	1856695067,	1901729851,
+	1947856969,	1995102917,	2043494831,	2093060508,	2143828418,	2195827721,	2249088285,	2303640702,
+	2359516308,	2416747195,	2475366238,	2535407106,	2596904286,	2659893102,	2724409733,	2790491237,
+	2858175571,	2927501613,	2998509181,	3071239063,	3145733033
+};
+
+#elif (EXPON_SEGMENT_SHIFT == 6)
+
+const uint32_t EXPON_TABLE[251] =
+{
+	19661,	20626,	21639,	22701,	23816,	24985,	26212,	27499,
+	28849,	30266,	31752,	33311,	34946,	36662,	38462,	40351,
+	42332,	44410,	46591,	48878,	51278,	53796,	56437,	59208,
+	62115,	65165,	68364,	71721,	75243,	78937,	82813,	86879,
+	91144,	95619,	100314,	105239,	110407,	115827,	121515,	127481,
+	133740,	140306,	147195,	154422,	162004,	169959,	178304,	187058,
+	196242,	205878,	215986,	226591,	237716,	249388,	261633,	274478,
+	287955,	302093,	316926,	332487,	348811,	365938,	383905,	402754,
+	422529,	443275,	465039,	487872,	511826,	536956,	563320,	590979,
+	619995,	650437,	682372,	715876,	751025,	787900,	826585,	867169,
+	909746,	954414,	1001275,	1050436,	1102012,	1156119,	1212884,	1272435,
+	1334910,	1400453,	1469214,	1541351,	1617030,	1696424,	1779717,	1867100,
+	1958772,	2054946,	2155842,	2261692,	2372738,	2489238,	2611457,	2739677,
+	2874192,	3015312,	3163361,	3318679,	3481623,	3652567,	3831904,	4020047,
+	4217428,	4424499,	4641738,	4869642,	5108737,	5359571,	5622721,	5898791,
+	6188416,	6492261,	6811024,	7145439,	7496273,	7864333,	8250464,	8655553,
+	9080532,	9526378,	9994113,	10484814,	10999609,	11539679,	12106265,	12700671,
+	13324262,	13978470,	14664799,	15384826,	16140206,	16932674,	17764052,	18636249,
+	19551271,	20511219,	21518300,	22574827,	23683229,	24846052,	26065969,	27345782,
+	28688433,	30097007,	31574740,	33125029,	34751436,	36457697,	38247734,	40125660,
+	42095790,	44162652,	46330995,	48605801,	50992299,	53495970,	56122570,	58878133,
+	61768991,	64801788,	67983492,	71321415,	74823226,	78496973,	82351097,	86394455,
+	90636338,	95086493,	99755146,	104653025,	109791386,	115182035,	120837360,	126770355,
+	132994655,	139524562,	146375081,	153561953,	161101694,	169011629,	177309934,	186015677,
+	195148864,	204730481,	214782546,	225328158,	236391549,	247998142,	260174607,	272948924,
+	286350448,	300409973,	315159807,	330633844,	346867640,	363898500,	381765559,	400509873,
+	420174513,	440804669,	462447745,	485153474,	508974033,	533964157,	560181272,	587685622,
+	616540408,	646811935,	678569765,	711886873,	746839819,	783508920,	821978437,	862336770,
+	904676657,	949095391,	995695042,	1044582689,	1095870672,	1149676844,	1206124847,	1265344391,
+	1327471556,	1392649104,	1461026805,	1532761785,	1608018881,	1686971027,	1769799645,	1856695067,
+	1947856969,	2043494831,	2143828418,	2249088285,	2359516308,	2475366238,	2596904286,	2724409733,
+	2858175571,	2998509181,	3145733033
+};
+
+#elif (EXPON_SEGMENT_SHIFT == 7)
+
+const uint32_t EXPON_TABLE[126] =
+{
+	19661,	21639,	23816,	26212,	28849,	31752,	34946,	38462,
+	42332,	46591,	51278,	56437,	62115,	68364,	75243,	82813,
+	91144,	100314,	110407,	121515,	133740,	147195,	162004,	178304,
+	196242,	215986,	237716,	261633,	287955,	316926,	348811,	383905,
+	422529,	465039,	511826,	563320,	619995,	682372,	751025,	826585,
+	909746,	1001275,	1102012,	1212884,	1334910,	1469214,	1617030,	1779717,
+	1958772,	2155842,	2372738,	2611457,	2874192,	3163361,	3481623,	3831904,
+	4217428,	4641738,	5108737,	5622721,	6188416,	6811024,	7496273,	8250464,
+	9080532,	9994113,	10999609,	12106265,	13324262,	14664799,	16140206,	17764052,
+	19551271,	21518300,	23683229,	26065969,	28688433,	31574740,	34751436,	38247734,
+	42095790,	46330995,	50992299,	56122570,	61768991,	67983492,	74823226,	82351097,
+	90636338,	99755146,	109791386,	120837360,	132994655,	146375081,	161101694,	177309934,
+	195148864,	214782546,	236391549,	260174607,	286350448,	315159807,	346867640,	381765559,
+	420174513,	462447745,	508974033,	560181272,	616540408,	678569765,	746839819,	821978437,
+	904676657,	995695042,	1095870672,	1206124847,	1327471556,	1461026805,	1608018881,	1769799645,
+	1947856969,	2143828418,	2359516308,	2596904286,	2858175571,	3145733033
+};
+
+#else
+#error "EXPON_SEGMENT_SHIFT must be 4 ... 7"
+#endif
+
+const uint32_t VEL_TABLE[5][65] =
+{
+	{
+		4096,	3584,	3174,	2839,	2560,	2324,	2121,	1946,
+		1792,	1656,	1536,	1428,	1331,	1243,	1164,	1091,
+		1024,	963,	906,	853,	805,	759,	717,	677,
+		640,	605,	572,	541,	512,	484,	458,	433,
+		410,	387,	366,	345,	326,	307,	289,	272,
+		256,	240,	225,	211,	197,	184,	171,	158,
+		146,	135,	124,	113,	102,	92,	83,	73,
+		64,	55,	47,	38,	30,	22,	15,	7,
+		0
+	},
+	{
+		4096,	3226,	2645,	2231,	1920,	1678,	1485,	1327,
+		1195,	1083,	987,	905,	832,	768,	711,	660,
+		614,	573,	535,	501,	469,	440,	414,	389,
+		366,	344,	324,	306,	288,	272,	256,	241,
+		228,	214,	202,	190,	179,	169,	158,	149,
+		140,	131,	122,	114,	107,	99,	92,	85,
+		79,	72,	66,	61,	55,	49,	44,	39,
+		34,	29,	25,	20,	16,	12,	8,	4,
+		0
+	},
+	{
+		4096,	2688,	1984,	1562,	1280,	1079,	928,	811,
+		717,	640,	576,	522,	475,	435,	400,	369,
+		341,	317,	294,	274,	256,	239,	224,	210,
+		197,	185,	174,	163,	154,	145,	136,	128,
+		120,	113,	107,	100,	94,	89,	83,	78,
+		73,	68,	64,	60,	56,	52,	48,	44,
+		41,	38,	34,	31,	28,	26,	23,	20,
+		18,	15,	13,	10,	8,	6,	4,	2,
+		0
+	},
+	{
+		4096,	2016,	1323,	976,	768,	629,	530,	456,
+		398,	352,	314,	283,	256,	233,	213,	196,
+		181,	167,	155,	144,	134,	125,	117,	109,
+		102,	96,	90,	85,	79,	75,	70,	66,
+		62,	58,	55,	52,	48,	45,	43,	40,
+		37,	35,	33,	31,	28,	26,	25,	23,
+		21,	19,	18,	16,	14,	13,	12,	10,
+		9,	8,	7,	5,	4,	3,	2,	1,
+		0
+	},
+	{
+		4096,	1344,	794,	558,	427,	343,	286,	243,
+		211,	185,	165,	147,	133,	121,	110,	101,
+		93,	86,	80,	74,	69,	64,	60,	56,
+		52,	49,	46,	43,	40,	38,	36,	34,
+		32,	30,	28,	26,	25,	23,	22,	20,
+		19,	18,	17,	15,	14,	13,	12,	11,
+		11,	10,	9,	8,	7,	7,	6,	5,
+		5,	4,	3,	3,	2,	2,	1,	1,
+		0
+	}
+};
+
+const uint32_t BENDER_TABLE[3][33] =
+{
+	{
+		0,	250,	500,	750,	1000,	1250,	1500,	1750,
+		2000,	2250,	2500,	2750,	3000,	3250,	3500,	3750,
+		4000,	4250,	4500,	4750,	5000,	5250,	5500,	5750,
+		6000,	6250,	6500,	6750,	7000,	7250,	7500,	7750,
+		8000
+	},
+	{
+		0,	125,	250,	378,	507,	640,	776,	916,
+		1062,	1213,	1372,	1537,	1710,	1893,	2084,	2286,
+		2500,	2724,	2961,	3212,	3476,	3755,	4049,	4360,
+		4687,	5032,	5395,	5777,	6179,	6602,	7045,	7511,
+		8000
+	},
+	{
+		0,	0,	1,	6,	15,	30,	52,	83,
+		125,	177,	244,	324,	421,	536,	669,	823,
+		1000,	1199,	1423,	1674,	1953,	2260,	2599,	2970,
+		3375,	3814,	4291,	4805,	5359,	5954,	6591,	7273,
+		8000
+	}
+};
+
+const uint32_t AT_TABLE[3][33] =
+{
+	{
+		0,	500,	1000,	1500,	2000,	2500,	3000,	3500,
+		4000,	4500,	5000,	5500,	6000,	6500,	7000,	7500,
+		8000,	8500,	9000,	9500,	10000,	10500,	11000,	11500,
+		12000,	12500,	13000,	13500,	14000,	14500,	15000,	15500,
+		16000
+	},
+	{
+		0,	150,	300,	450,	600,	750,	900,	1051,
+		1202,	1355,	1510,	1668,	1831,	2000,	2178,	2368,
+		2575,	2801,	3054,	3340,	3667,	4044,	4482,	4994,
+		5593,	6296,	7122,	8091,	9226,	10554,	12104,	13907,
+		16000
+	},
+	{
+		0,	25,	50,	75,	100,	125,	150,	176,
+		203,	232,	264,	300,	342,	393,	456,	536,
+		637,	766,	931,	1140,	1405,	1739,	2155,	2670,
+		3305,	4081,	5023,	6159,	7521,	9145,	11069,	13338,
+		16000
+	}
+};
+
@@ -0,0 +1,40 @@
+/*
+ * nl_tcd_tables.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ssc
+ *
+ *  const lookup tables of the TCD, placed in flash
+ *  the contents (nl_tcd_tables.c) are generated by tools/tcd_tables/gen_tcd_tables.c
+ */
+
+#ifndef TCD_NL_TCD_TABLES_H_
+#define TCD_NL_TCD_TABLES_H_
+
+#include "stdint.h"
+
+
+#ifndef EXPON_SEGMENT_SHIFT
+#define EXPON_SEGMENT_SHIFT	5		// segment width of the exponential table: 4 (1000 segments) ... 7 (125 segments)
+#endif
+
+#define EXPON_SEGMENTS		(16000 >> EXPON_SEGMENT_SHIFT)
+#define EXPON_TABLE_SIZE	(EXPON_SEGMENTS + 1)
+#define EXPON_FRACT_BITS	12		// table values are upscaled by 4096
+
+#define NUM_VEL_CURVES		5		// VEL_CURVE_VERY_SOFT ... VEL_CURVE_VERY_HARD
+#define VEL_TABLE_SIZE		65
+
+#define NUM_HW_CURVES		3		// 0: soft, 1: normal, 2: hard
+#define HW_TABLE_SIZE		33
+
+
+extern const uint32_t EXPON_TABLE[EXPON_TABLE_SIZE];						// 0.1 ... 16000 ms as a multiple of TIME_UNIT_MS, upscaled by 2^EXPON_FRACT_BITS
+extern const uint32_t EXPON_LIN_SLOPE;										// slope of the linear segment below 160, upscaled by 2^(EXPON_FRACT_BITS + 16)
+
+extern const uint32_t VEL_TABLE[NUM_VEL_CURVES][VEL_TABLE_SIZE];			// key-switch time -> velocity 4096 ... 0
+
+extern const uint32_t BENDER_TABLE[NUM_HW_CURVES][HW_TABLE_SIZE];			// absolute bender amount -> 0 ... 8000
+extern const uint32_t AT_TABLE[NUM_HW_CURVES][HW_TABLE_SIZE];				// aftertouch -> 0 ... 16000
+
+#endif /* TCD_NL_TCD_TABLES_H_ */
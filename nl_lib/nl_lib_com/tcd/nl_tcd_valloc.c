@@ -87,6 +87,11 @@ void VALLOC_Process(void)
 
 	uint32_t numKeyEvents = Emphase_IPC_M4_KeyBuffer_ReadBuffer(keyEvent, 32);		// reads the latest key up/down events from the ring buffer shared with the M0
 
+	if (numKeyEvents)
+	{
+		MSG_SetEventTime(MSG_GetTime());				// the key events of this scan share one timestamp
+	}
+
 	for (i = 0; i < numKeyEvents; i++)
 	{
 		uint32_t k = keyEvent[i].key;
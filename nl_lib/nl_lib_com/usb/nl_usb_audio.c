@@ -5,94 +5,159 @@
     @author		Nemanja Nikodijevic 2015-08-10
 *******************************************************************************/
 #include <stdint.h>
-#include <stdlib.h>
+#include <string.h>
 #include "cmsis/LPC43xx.h"
 #include "usb/nl_usb_audio.h"
 #include "usb/nl_usb_descaudio.h"
 #include "usb/nl_usb_core.h"
 #include "usb/nl_usbd.h"
+#include "drv/nl_i2s_dma.h"
 
 #define AUDIO_VOLUME_MAX		0xFFF0
 #define AUDIO_VOLUME_MIN		0xE3A0
 #define AUDIO_VOLUME_RES		0x0030
 
-#define USB_AUDIO_OUTBUFF_SIZE		USB_AUDIO_ISO_MAX_PKT
-static uint8_t outbuff[USB_AUDIO_OUTBUFF_SIZE];
-//static uint8_t inbuff[USB_AUDIO_OUTBUFF_SIZE];
-static uint8_t tmpoutbuff[USB_AUDIO_OUTBUFF_SIZE*2];
+#define USB_AUDIO_RING_WORDS	(USB_AUDIO_RING_FRAMES * 2)
+#define USB_AUDIO_PKT_WORDS		(USB_AUDIO_ISO_MAX_PKT / 4)
+#define USB_AUDIO_FB_NOMINAL	((USB_AUDIO_SAMPLE_RATE / 1000) << 14)
 
-static uint32_t sampleFreq = 48000;
+/** ring of the I2S DMA, the OUT endpoint writes the packets directly into it.
+ *  A packet which crosses the end goes into the spare words behind the ring,
+ *  this part is copied to the start. */
+static uint32_t ring[USB_AUDIO_RING_WORDS + USB_AUDIO_PKT_WORDS] __attribute__((aligned(4)));
+static uint32_t ringWrite = 0;			// word index of the next packet, always the start of a frame
+static uint32_t lastFill = 0;			// words ahead of the DMA after the last packet
+
+/** feedback: samples per frame, 10.14 format */
+static uint32_t feedback = USB_AUDIO_FB_NOMINAL;
+static uint32_t fbRate = USB_AUDIO_FB_NOMINAL;		// measured rate of the I2S
+static uint32_t fbLastPos = 0;
+static uint32_t fbConsumed = 0;						// words played in the current measurement
+static uint32_t fbFrames = 0;
+
+static USB_AUDIO_STATS_T stats;
+
+static uint32_t sampleFreq = USB_AUDIO_SAMPLE_RATE;
 static uint16_t volumeOut = 0xFFC0;
 static uint8_t 	muteOut = 0;
 static uint32_t tmpVol = 0;
 
 static uint8_t outInterfaceOn = 0;
 
-static AudioRcvCallback Audio_Callback_OUT = 0;
-static LPC_TIMERn_Type *USB_Timer = 0;
+static LPC_I2Sn_Type *audioI2S = 0;
 
-static void USB_Timer_Init(void) {
-	USB_Timer->CCR &= ~(0x03);
-	USB_Timer->CCR |= 1;		/* timer mode - capture on rising edge */
-
-	USB_Timer->TC = 0;
-	USB_Timer->PC = 0;
-	USB_Timer->PR = 0;
+/******************************************************************************/
+/** @brief		Words in the ring which the DMA has not played yet
+*******************************************************************************/
+static uint32_t USB_Audio_Fill(void)
+{
+	return (ringWrite + USB_AUDIO_RING_WORDS - I2S_DMA_StreamPos(I2S_DMA_TX)) % USB_AUDIO_RING_WORDS;
+}
 
-	/* reset TC */
-	USB_Timer->TCR |= (1<<1);
-	USB_Timer->TCR &= ~(1<<1);
+/******************************************************************************/
+/** @brief		Puts the write position half a ring ahead of the DMA
+*******************************************************************************/
+static void USB_Audio_Center(void)
+{
+	ringWrite = ((I2S_DMA_StreamPos(I2S_DMA_TX) + USB_AUDIO_RING_WORDS / 2) % USB_AUDIO_RING_WORDS) & ~1;
+	lastFill = USB_AUDIO_RING_WORDS / 2;
 }
 
-static void USB_Timer_Start(void) {
-	/* reset TC */
-	USB_Timer->TCR = 0;
-	USB_Timer->TCR |= (1<<1);
-	USB_Timer->TCR &= ~(1<<1);
-	USB_Timer->TC = 0;
-	USB_Timer->TCR = 1;
+/******************************************************************************/
+/** @brief		Starts the I2S DMA with a silent ring and the OUT endpoint
+*******************************************************************************/
+static void USB_Audio_Start(void)
+{
+	I2S_DMA_StopStream(I2S_DMA_TX);
+	memset(ring, 0, sizeof(ring));
+
+	fbRate = feedback = USB_AUDIO_FB_NOMINAL;
+	fbLastPos = 0;
+	fbConsumed = 0;
+	fbFrames = 0;
+
+	I2S_DMA_StartStream(audioI2S, I2S_DMA_TX, ring, USB_AUDIO_RING_WORDS / 4, 4, NULL);		// no callbacks, the packets follow the position
+	USB_Audio_Center();
+
+	USB_ReadReqEP(0x01, (uint8_t*)(ring + ringWrite), USB_AUDIO_ISO_MAX_PKT);
 }
 
-static void USB_Audio_SOF(void) {
-	static uint32_t feedback = 0xBFFD5;//(203989<<14)/4250;//48<<14;
-	uint32_t timer_val;
+/******************************************************************************/
+/** @brief		Start of frame: measures the rate of the I2S by the words the
+ * 				DMA has played and sends it as feedback, with a correction
+ * 				that keeps the ring half full
+*******************************************************************************/
+static void USB_Audio_SOF(void)
+{
+	uint32_t pos;
+	int32_t fb;
 
-	if(outInterfaceOn) {
-		if(outInterfaceOn == 2) {
-			USB_Timer_Start();
-			outInterfaceOn = 1;
-		} else {
-			timer_val = USB_Timer->TC;
-				feedback = timer_val<<14/8500; //204000000 / 4250 = 48000
-			USB_Timer_Start();
-		}
-		USB_WriteEP(0x81, (uint8_t*)&feedback, 3);
+	if(!outInterfaceOn)
+		return;
+
+	pos = I2S_DMA_StreamPos(I2S_DMA_TX);
+	fbConsumed += (pos + USB_AUDIO_RING_WORDS - fbLastPos) % USB_AUDIO_RING_WORDS;
+	fbLastPos = pos;
+
+	if(++fbFrames == (1 << USB_AUDIO_FB_SHIFT))
+	{
+		/* stereo frames in 2^FB_SHIFT USB frames -> 10.14, low-pass against the DMA bursts */
+		fb = (fbConsumed / 2) << (14 - USB_AUDIO_FB_SHIFT);
+		fbRate = (int32_t)fbRate + (fb - (int32_t)fbRate) / 4;
+		fbConsumed = 0;
+		fbFrames = 0;
 	}
+
+	/* 1/256 of the fill error per frame (words / 2 = frames) */
+	fb = (int32_t)fbRate + ((int32_t)(USB_AUDIO_RING_WORDS / 2) - (int32_t)USB_Audio_Fill()) * (1 << (14 - 8 - 1));
+
+	if(fb > USB_AUDIO_FB_NOMINAL + (1 << 14))
+		fb = USB_AUDIO_FB_NOMINAL + (1 << 14);
+	else if(fb < USB_AUDIO_FB_NOMINAL - (1 << 14))
+		fb = USB_AUDIO_FB_NOMINAL - (1 << 14);
+
+	feedback = fb;
+	stats.feedback = fb;
+
+	if(USB_Core_ReadyToWrite(0x81))						// otherwise the waiting transfer takes the new value
+		USB_WriteEP(0x81, (uint8_t*)&feedback, 3);
 }
 
 /******************************************************************************/
-/** @brief		Endpoint 1 Callback
+/** @brief		Endpoint 1 Callback: the packet is already in the ring, the
+ * 				endpoint is primed behind it
     @param[in]	event	Event that triggered the interrupt
 *******************************************************************************/
 static void USB_EndPoint1 (uint32_t event) {
 
-	uint32_t length;
-	uint16_t i,j;
+	uint32_t words;
+	uint32_t fill;
 
 	switch (event) {
 	case USB_EVT_OUT:
-		length = USB_ReadEP(0x01, outbuff);
-		if(length) {
-			for(i=0, j=0; i<length; i+=3, j+=4) {
-				tmpoutbuff[j]	= 0;
-				tmpoutbuff[j+1] = outbuff[i];
-				tmpoutbuff[j+2] = outbuff[i+1];
-				tmpoutbuff[j+3] = outbuff[i+2];
+		words = USB_ReadEP(0x01, (uint8_t*)(ring + ringWrite)) / 4;
+		if(words) {
+			stats.packets++;
+
+			if(ringWrite + words > USB_AUDIO_RING_WORDS)			// overhang behind the ring
+				memcpy(ring, ring + USB_AUDIO_RING_WORDS, (ringWrite + words - USB_AUDIO_RING_WORDS) * 4);
+			ringWrite = (ringWrite + words) % USB_AUDIO_RING_WORDS;
+
+			fill = USB_Audio_Fill();
+			if((fill < USB_AUDIO_PKT_WORDS) || (fill > USB_AUDIO_RING_WORDS - USB_AUDIO_PKT_WORDS)) {
+				/* the DMA has reached the data (or passed it), or the next packet
+				 * would overwrite data which is not played yet: the trend of the
+				 * fill level tells which one */
+				if(lastFill < USB_AUDIO_RING_WORDS / 2)
+					stats.underruns++;
+				else
+					stats.overruns++;
+				USB_Audio_Center();
 			}
-			if(Audio_Callback_OUT)
-				Audio_Callback_OUT((uint32_t*)tmpoutbuff, j/4);
+			else
+				lastFill = fill;
 		}
-		USB_ReadReqEP(0x01, outbuff, USB_AUDIO_OUTBUFF_SIZE);
+		USB_ReadReqEP(0x01, (uint8_t*)(ring + ringWrite), USB_AUDIO_ISO_MAX_PKT);
 	  break;
 	}
 }
@@ -120,10 +185,11 @@ static void USB_Audio_Interface_Event(USB_SETUP_PACKET* spkt)
 	else if(wIndex == USB_AUDIO_OUTPUT_INTERFACE)	//interface 2: streaming OUT - speaker (EP 1)
 	{
 		if(wValue == 0x0001) {
-			USB_ReadReqEP(0x01, outbuff, USB_AUDIO_OUTBUFF_SIZE);
-			outInterfaceOn = 2;
+			USB_Audio_Start();
+			outInterfaceOn = 1;
 		} else {
 			USB_ResetEP(0x01);
+			I2S_DMA_StopStream(I2S_DMA_TX);
 			outInterfaceOn = 0;
 		}
 	}
@@ -235,11 +301,12 @@ static uint8_t USB_Audio_Class_Request(USB_SETUP_PACKET* spkt, USB_EP_DATA* ep0d
 
 /******************************************************************************/
 /** @brief    Function that initializes USB Audio driver for USB0 controller
+ *  @param[in]	I2Sx	I2S peripheral, initialized for 32 bits and
+ *  					USB_AUDIO_SAMPLE_RATE (I2S_DMA_Init)
 *******************************************************************************/
-void USB_Audio_Init(AudioRcvCallback audrcv, LPC_TIMERn_Type *TIMx)
+void USB_Audio_Init(LPC_I2Sn_Type *I2Sx)
 {
-	Audio_Callback_OUT = audrcv;
-	USB_Timer = TIMx;
+	audioI2S = I2Sx;
 	/** assign descriptors */
 	USB_Core_Device_Descriptor_Set((const uint8_t*) USB_Audio_DeviceDescriptor);
 	USB_Core_Device_FS_Descriptor_Set((const uint8_t*) USB_Audio_FSConfigDescriptor);
@@ -253,15 +320,23 @@ void USB_Audio_Init(AudioRcvCallback audrcv, LPC_TIMERn_Type *TIMx)
 	USB_Core_SOF_Event_Handler_Set(USB_Audio_SOF);
 	USB_Core_Init();
 	USB_Core_ForceFullSpeed();
-	USB_Timer_Init();
-	NVIC_EnableIRQ(USB0_IRQn);
 }
 
 /******************************************************************************/
-/** @brief    Function for polling the USB Audio driver
+/** @brief    Function for polling the USB Audio driver, no effect in
+ *            interrupt mode
 *******************************************************************************/
 void USB_Audio_Poll(void)
 {
+#if USB_POLLING
 	USB0_IRQHandler();
+#endif
 }
 
+/******************************************************************************/
+/** @brief    Counters of the stream
+*******************************************************************************/
+const USB_AUDIO_STATS_T* USB_Audio_GetStats(void)
+{
+	return &stats;
+}
@@ -8,6 +8,9 @@
 #ifndef _NL_USB_AUDIO_H_
 #define _NL_USB_AUDIO_H_
 
+#include <stdint.h>
+#include "cmsis/LPC43xx.h"
+
 /** Audio Request codes */
 #define USB_AUDIO_REQ_SET_CUR		0x01
 #define USB_AUDIO_REQ_GET_CUR		0x81
@@ -22,12 +25,28 @@
 #define USB_AUDIO_MUTE_CTRL			0x01
 #define USB_AUDIO_VOLUME_CTRL		0x02
 
-/* Definition for Audio Receive Callback function */
-typedef void (*AudioRcvCallback)(uint32_t* buff, uint32_t len);
+/** Stream: 2 channels, 24 bits in 4-byte subframes (left-justified, the word
+ *  format of the I2S FIFO), played from a DMA ring without copying
+ * @{
+ */
+#define USB_AUDIO_SAMPLE_RATE		48000
+/** size of the I2S ring in stereo frames (8 ms), the latency is half of it */
+#define USB_AUDIO_RING_FRAMES		384
+/** the rate of the I2S is measured over 2^USB_AUDIO_FB_SHIFT USB frames */
+#define USB_AUDIO_FB_SHIFT			6
+/** @} */
+
+typedef struct {
+  uint32_t packets;			/* received OUT packets */
+  uint32_t underruns;		/* the DMA reached data which was not received yet */
+  uint32_t overruns;		/* a packet would have overwritten data which was not played yet */
+  uint32_t feedback;		/* last feedback value, samples per frame (10.14) */
+} USB_AUDIO_STATS_T;
 
 /* USB Audio functions */
-void USB_Audio_Init(AudioRcvCallback audrcv, LPC_TIMERn_Type *TIMx);
+void USB_Audio_Init(LPC_I2Sn_Type *I2Sx);
 void USB_Audio_Poll(void);
+const USB_AUDIO_STATS_T* USB_Audio_GetStats(void);
 
 
 #endif
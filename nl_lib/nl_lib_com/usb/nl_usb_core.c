@@ -26,18 +26,35 @@
 DQH_T ep_QH[EP_NUM_MAX];
 #pragma data_alignment=32
 DTD_T ep_TD[EP_NUM_MAX];
+#pragma data_alignment=32
+DTD_T ep_TD_pool[EP_NUM_MAX][USB_DTD_POOL_SIZE];
 #pragma data_alignment=4
 #elif defined   (  __GNUC__  )
 #define __align(x) __attribute__((aligned(x)))
 DQH_T ep_QH[EP_NUM_MAX] __attribute__((aligned(2048)));
 DTD_T ep_TD[EP_NUM_MAX] __attribute__((aligned(32)));
+DTD_T ep_TD_pool[EP_NUM_MAX][USB_DTD_POOL_SIZE] __attribute__((aligned(32)));
 #else
 DQH_T __align(2048) ep_QH[EP_NUM_MAX];
 DTD_T __align(32) ep_TD[EP_NUM_MAX];
+DTD_T __align(32) ep_TD_pool[EP_NUM_MAX][USB_DTD_POOL_SIZE];
 #endif
 
 static uint32_t ep_read_len[3];
 
+/** bulk IN endpoints queue their transfers in a chain of dTDs from ep_TD_pool,
+ *  td_tail ... td_head-1 are linked and not retired yet (free-running) */
+static uint8_t  td_chained[EP_NUM_MAX];
+static uint32_t td_head[EP_NUM_MAX];
+static uint32_t td_tail[EP_NUM_MAX];
+
+/** deferred work: posted by the USB interrupt, executed by USB_Core_ProcessDeferred */
+static DeferredWorkHandler deferredWork[USB_DEFERRED_NUM];
+static uint32_t deferredArg[USB_DEFERRED_NUM];
+static volatile uint32_t deferredHead = 0;			/* written by the interrupt only */
+static volatile uint32_t deferredTail = 0;			/* written by the task only */
+static uint32_t deferredLost = 0;
+
 EndpointCallback USB_P_EP[USB_EP_NUM];
 
 InterfaceEventHandler USB_Interface_Event = NULL;
@@ -130,6 +147,8 @@ static void USB_Reset (void)
 	memset((void*)ep_QH, 0, EP_NUM_MAX * sizeof(DQH_T));
 	/* Zero out the device transfer descriptors */
 	memset((void*)ep_TD, 0, EP_NUM_MAX * sizeof(DTD_T));
+	memset((void*)ep_TD_pool, 0, sizeof(ep_TD_pool));
+	memset((void*)td_chained, 0, sizeof(td_chained));
 	memset((void*)ep_read_len, 0, sizeof(ep_read_len));
 	/* Configure the Endpoint List Address */
 	/* make sure it in on 64 byte boundary !!! */
@@ -229,10 +248,10 @@ void USB_Core_Init(void) {
 	on the port(CCS=1), port enable/disable status change(PES=1). */
 	LPC_USB->OTGSC = (1<<3) | (1<<0) /*| (1<<16)| (1<<24)| (1<<25)| (1<<26)| (1<<27)| (1<<28)| (1<<29)| (1<<30)*/;
 
+	deferredHead = deferredTail = 0;
+
 #if USB_POLLING
 		NVIC_DisableIRQ(USB0_IRQn);
-#else
-		NVIC_EnableIRQ(USB0_IRQn);
 #endif
 
 	USB_Reset();
@@ -240,8 +259,11 @@ void USB_Core_Init(void) {
 
 	/* USB Connect */
 	LPC_USB->USBCMD_D |= USBCMD_RS;
+
 #if !USB_POLLING
-	while(!USB_Configuration);
+	/* the enumeration runs in the interrupt, the caller waits with a time-out for USB_Core_IsConfigured() */
+	NVIC_SetPriority(USB0_IRQn, USB_IRQ_PRIORITY);
+	NVIC_EnableIRQ(USB0_IRQn);
 #endif
 }
 
@@ -281,12 +303,105 @@ uint8_t USB_Core_IsConfigured(void)
 *******************************************************************************/
 uint8_t USB_Core_ReadyToWrite(uint8_t epnum) {
 	uint32_t ep = EPAdr(epnum);
+	if(td_chained[ep])
+		return (USB_RetireDTD(ep) < USB_DTD_POOL_SIZE);
 	if((ep_TD[ep].next_dTD & 1) && ((ep_TD[ep].total_bytes & 1<<7)==0))
 		return 1;
 	else
 		return 0;
 }
 
+/******************************************************************************/
+/** @brief		Number of transfers of the endpoint which are not finished yet
+	@param[in]	ep	Endpoint number
+    @return		0 ... USB_DTD_POOL_SIZE for a bulk IN endpoint, 0 or 1 otherwise
+*******************************************************************************/
+uint32_t USB_Core_PendingTransfers(uint8_t epnum) {
+	uint32_t ep = EPAdr(epnum);
+	if(td_chained[ep])
+		return USB_RetireDTD(ep);
+	return (ep_TD[ep].total_bytes & 1<<7) ? 1 : 0;
+}
+
+/******************************************************************************/
+/** @brief		Checks whether an endpoint is primed or being primed
+	@param[in]	epnum	Endpoint number and direction
+    @return		1 - primed ; 0 - not primed
+*******************************************************************************/
+uint32_t USB_Core_EndpointPrimed(uint8_t epnum) {
+	uint32_t bit = 1 << USB_EP_BITPOS(epnum);
+	return ((LPC_USB->ENDPTPRIME | LPC_USB->ENDPTSTAT) & bit) ? 1 : 0;
+}
+
+/******************************************************************************/
+/** @brief		Enables or disables the NAK interrupt of an endpoint, e.g.
+ * 				while the class has no buffer to prime it with
+	@param[in]	epnum	Endpoint number and direction
+	@param[in]	on		1 - enable ; 0 - disable
+*******************************************************************************/
+void USB_Core_EndpointNak(uint8_t epnum, uint8_t on) {
+	uint32_t bit = 1 << USB_EP_BITPOS(epnum);
+	if(on)
+		LPC_USB->ENDPTNAKEN |= bit;
+	else
+		LPC_USB->ENDPTNAKEN &= ~bit;
+}
+
+/******************************************************************************/
+/** @brief		Posts a class callback from the interrupt to the task level
+	@param[in]	work	Function to be called by USB_Core_ProcessDeferred
+	@param[in]	arg		Argument of the function
+    @return		1 - Success ; 0 - queue full, the work is lost
+*******************************************************************************/
+uint32_t USB_Core_Defer(DeferredWorkHandler work, uint32_t arg) {
+	uint32_t head = deferredHead;
+	if((head - deferredTail) >= USB_DEFERRED_NUM)
+	{
+		deferredLost++;
+		return 0;
+	}
+	deferredWork[head % USB_DEFERRED_NUM] = work;
+	deferredArg[head % USB_DEFERRED_NUM] = arg;
+	deferredHead = head + 1;
+	return 1;
+}
+
+/******************************************************************************/
+/** @brief		Executes the deferred class callbacks (COOS task, every 125 us)
+*******************************************************************************/
+void USB_Core_ProcessDeferred(void) {
+	uint32_t tail;
+	while(deferredTail != deferredHead)
+	{
+		tail = deferredTail;
+		deferredWork[tail % USB_DEFERRED_NUM](deferredArg[tail % USB_DEFERRED_NUM]);
+		deferredTail = tail + 1;
+	}
+}
+
+/******************************************************************************/
+/** @brief		Number of deferred callbacks lost because of a full queue
+*******************************************************************************/
+uint32_t USB_Core_GetDeferredLost(void) {
+	return deferredLost;
+}
+
+/******************************************************************************/
+/** @brief		Keeps the USB interrupt away while the task level works on
+				the endpoints (no effect in polling mode)
+*******************************************************************************/
+void USB_Core_Lock(void) {
+#if !USB_POLLING
+	NVIC_DisableIRQ(USB0_IRQn);
+#endif
+}
+
+void USB_Core_Unlock(void) {
+#if !USB_POLLING
+	NVIC_EnableIRQ(USB0_IRQn);
+#endif
+}
+
 /******************************************************************************/
 /** @brief		Reset USB core
 *******************************************************************************/
@@ -648,6 +763,11 @@ static void USB_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD) {
                       | QH_IOS | QH_ZLT ;
     /* The next DTD pointer is INVALID */
     ep_TD[num].next_dTD = 0x01 ;
+    /* bulk IN: transfers are queued in the dTD pool */
+    td_chained[num] = ((bmAttributes == USB_ENDPOINT_TYPE_BULK) && (pEPD->bEndpointAddress & 0x80)) ? 1 : 0;
+    td_head[num] = td_tail[num] = 0;
+    if (td_chained[num])
+      ep_QH[num].next_dTD = 0x01;
   }
   else
   {
@@ -655,6 +775,7 @@ static void USB_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD) {
     ep_QH[num].cap  = QH_MAXP(pEPD->wMaxPacketSize) | QH_ZLT | (1<<30);
     /* The next DTD pointer is INVALID */
     ep_QH[num].next_dTD = ep_TD[num].next_dTD = 0x01 ;
+    td_chained[num] = 0;
   }
   /* setup EP control register */
   if (pEPD->bEndpointAddress & 0x80)
@@ -1198,14 +1319,20 @@ void USB0_IRQHandler (void)
 	/* EP 1 - IN */
 	if (val & (1<<17))
 	{
-		ep_TD [3].total_bytes &= 0xC0;
+		if (td_chained[3])
+			USB_RetireDTD(3);
+		else
+			ep_TD [3].total_bytes &= 0xC0;
 		LPC_USB->ENDPTCOMPLETE = (1<<17);
 		USB_P_EP[1](USB_EVT_IN);
 	}
 	/* EP 2 - IN */
 	if (val & (1<<18))
 	{
-		ep_TD [5].total_bytes &= 0xC0;
+		if (td_chained[5])
+			USB_RetireDTD(5);
+		else
+			ep_TD [5].total_bytes &= 0xC0;
 		LPC_USB->ENDPTCOMPLETE = (1<<18);
 		USB_P_EP[2](USB_EVT_IN);
 	}
@@ -1278,6 +1405,88 @@ void USB_ProgDTD(uint32_t Edpt, uint32_t ptrBuff, uint32_t TsfSize)
 	ep_QH[Edpt].total_bytes &= (~0xC0) ;
 }
 
+/******************************************************************************/
+/** @brief		Retires the finished dTDs of a chained endpoint
+    @param[in]	Edpt	Endpoint number in the endpoint queue
+    @return		Number of dTDs still in the queue
+*******************************************************************************/
+uint32_t USB_RetireDTD(uint32_t Edpt)
+{
+	while ( (td_tail[Edpt] != td_head[Edpt])
+		 && ((ep_TD_pool[Edpt][td_tail[Edpt] % USB_DTD_POOL_SIZE].total_bytes & 0x80) == 0) )
+	{
+		td_tail[Edpt]++;
+	}
+
+	return td_head[Edpt] - td_tail[Edpt];
+}
+
+/******************************************************************************/
+/** @brief		Appends a dTD to the queue of a chained endpoint and primes the
+				endpoint, if the controller has already left the queue
+				(LPC43xx user manual: "Executing a transfer descriptor")
+    @param[in]	Edpt	Endpoint number in the endpoint queue
+    @param[in]	bit		Bit of the endpoint in ENDPTPRIME / ENDPTSTAT
+    @param[in]	ptrBuff	Pointer to data buffer
+    @param[in]	TsfSize	Size of the transfer buffer
+    @return		TsfSize - Success ; 0 - all dTDs in use
+*******************************************************************************/
+static uint32_t USB_QueueDTD(uint32_t Edpt, uint32_t bit, uint32_t ptrBuff, uint32_t TsfSize)
+{
+	DTD_T*  pDTD;
+	DTD_T*  pLast;
+	uint32_t status;
+
+	if (USB_RetireDTD(Edpt) >= USB_DTD_POOL_SIZE)
+		return 0;
+
+	pDTD = &ep_TD_pool[Edpt][td_head[Edpt] % USB_DTD_POOL_SIZE];
+
+	memset((void*)pDTD, 0, sizeof(DTD_T));
+	pDTD->next_dTD = TD_NEXT_TERMINATE;
+
+	pDTD->total_bytes = ((TsfSize & 0x7fff) << 16);
+	pDTD->total_bytes |= TD_IOC ;
+	pDTD->total_bytes |= 0x80 ;
+
+	pDTD->buffer0 = ptrBuff;
+	pDTD->buffer1 = (ptrBuff + 0x1000) & 0xfffff000;
+	pDTD->buffer2 = (ptrBuff + 0x2000) & 0xfffff000;
+	pDTD->buffer3 = (ptrBuff + 0x3000) & 0xfffff000;
+	pDTD->buffer4 = (ptrBuff + 0x4000) & 0xfffff000;
+
+	if (td_head[Edpt] != td_tail[Edpt])
+	{
+		/* queue not empty: linking the new dTD behind the last one */
+		pLast = &ep_TD_pool[Edpt][(td_head[Edpt] - 1) % USB_DTD_POOL_SIZE];
+		pLast->next_dTD = (uint32_t)pDTD;
+		td_head[Edpt]++;
+
+		if (LPC_USB->ENDPTPRIME & bit)
+			return TsfSize;							/* still priming, the controller will find the new dTD */
+
+		do {
+			LPC_USB->USBCMD_D |= USBCMD_ATDTW;		/* tripwire: ENDPTSTAT is only valid if ATDTW stays set */
+			status = LPC_USB->ENDPTSTAT & bit;
+		} while ((LPC_USB->USBCMD_D & USBCMD_ATDTW) == 0);
+		LPC_USB->USBCMD_D &= ~USBCMD_ATDTW;
+
+		if (status)
+			return TsfSize;							/* the endpoint is still working on the queue */
+	}
+	else
+	{
+		td_head[Edpt]++;
+	}
+
+	/* queue empty or already left by the controller: priming with the new dTD */
+	ep_QH[Edpt].next_dTD = (uint32_t)pDTD;
+	ep_QH[Edpt].total_bytes &= (~0xC0) ;
+	LPC_USB->ENDPTPRIME |= bit;
+
+	return TsfSize;
+}
+
 /******************************************************************************/
 /** @brief		Write USB endpoint data
     @param[in]	EPNum	Endpoint number and direction
@@ -1291,6 +1500,9 @@ uint32_t USB_WriteEP(uint32_t EPNum, uint8_t *pData, uint32_t cnt)
 {
 	uint32_t n = USB_EP_BITPOS(EPNum);
 
+	if (td_chained[EPAdr(EPNum)])
+		return USB_QueueDTD(EPAdr(EPNum), (1<<n), (uint32_t)pData, cnt);
+
 	USB_ProgDTD(EPAdr(EPNum), (uint32_t)pData, cnt);
 	/* prime the endpoint for transmit */
 	LPC_USB->ENDPTPRIME |= (1<<n);
@@ -1341,19 +1553,6 @@ uint32_t USB_ReadReqEP(uint32_t EPNum, uint8_t *pData, uint32_t len)
   return len;
 }
 
-/******************************************************************************/
-/** @brief		Gets the number of bytes left to be sent
-    @param[in]	endbuff	End of buffer address
-    @param[in]	ep		Endpoint number and direction
-    					7	Direction (0 - out; 1-in)
-    					3:0	Endpoint number
-    @return		Number of bytes left to be sent
-*******************************************************************************/
-uint32_t USB_Core_BytesToSend(uint32_t endbuff, uint32_t ep)
-{
-	return ((endbuff - ep_QH[EPAdr(ep)].buffer0) & 0xFFF);
-}
-
 void USB_Core_Device_Descriptor_Set(const uint8_t* ddesc)
 {
 	USB_DeviceDescriptor = ddesc;
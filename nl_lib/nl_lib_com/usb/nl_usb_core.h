@@ -20,11 +20,21 @@
 #define EP_NUM_MAX			6
 /** Total logical endpoints */
 #define USB_EP_NUM			3
+/** dTDs per bulk IN endpoint (transfers in flight) */
+#define USB_DTD_POOL_SIZE	4
 /** Maximum length of a Control endpoint packet */
 #define USB_MAX_PACKET0     64
 
-/** USB driver in polling mode? */
-#define USB_POLLING 	1
+/** USB driver in polling mode?
+ *  0: USB0 interrupt, the class callbacks are deferred to USB_Core_ProcessDeferred
+ *  1: USB0_IRQHandler is called by a polling task */
+#ifndef USB_POLLING
+#define USB_POLLING 	0
+#endif
+/** Priority of the USB0 interrupt (0 ... 7) */
+#define USB_IRQ_PRIORITY	6
+/** Number of entries in the deferred-work queue */
+#define USB_DEFERRED_NUM	16
 
 /* USB Endpoint Data Structure */
 typedef struct _USB_EP_DATA {
@@ -40,6 +50,8 @@ typedef void (*InterfaceEventHandler)(USB_SETUP_PACKET* spkt);
 typedef uint8_t (*ClassRequestHandler)(USB_SETUP_PACKET* spkt, USB_EP_DATA* ep0dat, uint32_t event);
 /* Definition for the Start of Frame handler */
 typedef void (*SOFHandler)(void);
+/* Definition for work deferred from the interrupt to the task level */
+typedef void (*DeferredWorkHandler)(uint32_t arg);
 
 /** dTD Transfer Descriptor */
 typedef volatile struct
@@ -217,7 +229,14 @@ void USB_Core_Init(void);
 void USB_Core_Endpoint_Callback_Set(uint8_t ep, EndpointCallback cb);
 uint8_t USB_Core_IsConfigured(void);
 uint8_t USB_Core_ReadyToWrite(uint8_t epnum);
-uint32_t USB_Core_BytesToSend(uint32_t endbuff, uint32_t ep);
+uint32_t USB_Core_PendingTransfers(uint8_t epnum);
+uint32_t USB_Core_EndpointPrimed(uint8_t epnum);
+void USB_Core_EndpointNak(uint8_t epnum, uint8_t on);
+uint32_t USB_Core_Defer(DeferredWorkHandler work, uint32_t arg);
+void USB_Core_ProcessDeferred(void);
+uint32_t USB_Core_GetDeferredLost(void);
+void USB_Core_Lock(void);
+void USB_Core_Unlock(void);
 void USB_Core_ForceFullSpeed(void);
 
 void USB_Core_Interface_Event_Handler_Set(InterfaceEventHandler ievh);
@@ -234,6 +253,7 @@ void USB_Core_Device_Device_Quali_Descriptor_Set(const uint8_t* dqdesc);
 void USB0_IRQHandler(void);
 
 uint32_t USB_WriteEP(uint32_t EPNum, uint8_t *pData, uint32_t cnt);
+uint32_t USB_RetireDTD(uint32_t Edpt);
 uint32_t USB_ReadEP(uint32_t EPNum, uint8_t *pData);
 uint32_t USB_ReadReqEP(uint32_t EPNum, uint8_t *pData, uint32_t len);
 void USB_ResetEP (uint32_t EPNum);
@@ -217,7 +217,7 @@ const uint8_t USB_Audio_FSConfigDescriptor[] = {
 	USB_AUDIO_FORMAT_TYPE_SUBTYPE,
 	0x01,		/* bFormatType I */
 	0x02,		/* bNrChannels */
-	0x03,		/* bSubframeSize */
+	0x04,		/* bSubframeSize - left-justified in 32 bits, the I2S word */
 	0x18,		/* bBitResolution - 24-bit */
 	0x01,		/* bSamFreqType */
 	B3VAL(0xBB80),	/* tSamFreq [0] - 48000 */
@@ -226,7 +226,7 @@ const uint8_t USB_Audio_FSConfigDescriptor[] = {
 	USB_ENDPOINT_DESCRIPTOR_TYPE,
 	USB_ENDPOINT_OUT(0x01),
 	(USB_ENDPOINT_TYPE_ISOCHRONOUS | USB_ENDPOINT_SYNC_ASYNCHRONOUS),
-	WBVAL(USB_AUDIO_ISO_MAX_PKT),	/* wMaxPacketSize - 582 (6*97) */
+	WBVAL(USB_AUDIO_ISO_MAX_PKT),	/* wMaxPacketSize - 392 (8*49) */
 	0x01,			/* bInterval */
 	0x00,
 	0x81,			/* bSynchAddress */
@@ -242,7 +242,7 @@ const uint8_t USB_Audio_FSConfigDescriptor[] = {
 	USB_ENDPOINT_DESCRIPTOR_TYPE,
 	USB_ENDPOINT_IN(0x01),
 	(USB_ENDPOINT_TYPE_ISOCHRONOUS),
-	WBVAL(0x0003),	/* wMaxPacketSize - 582 (6*97) */
+	WBVAL(0x0003),	/* wMaxPacketSize - 3 (10.14 feedback) */
 	0x01,			/* bInterval */
 	0x01,			/* bRefresh */
 	0x00,
@@ -23,7 +23,7 @@
 #define BCD_DEVICE	0x0001
 /** @} */
 
-#define USB_AUDIO_ISO_MAX_PKT	0x126//0x246
+#define USB_AUDIO_ISO_MAX_PKT	0x188		// 49 stereo frames of 4-byte subframes (feedback above nominal)
 
 #define USB_AUDIO_OUTPUT_INTERFACE	0x01
 #define USB_AUDIO_INPUT_INTERFACE	0x02
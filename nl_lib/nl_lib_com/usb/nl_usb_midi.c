@@ -2,16 +2,22 @@
 /** @file		nl_usb_midi.c
     @date		2014-12-11
     @brief    	Functions for the USB-MIDI driver
-    @example	Interrupt mode:
+    @example	Interrupt mode (USB_POLLING 0):
     			main() {
     				...
     				USB_MIDI_Init();
     				...
     				while(1) {
+    					USB_Core_ProcessDeferred();		// received data and IN completions
     					USB_MIDI_Send(buffer, length, 1);
     				}
     			}
 
+    			With USB_MIDI_SOF_FLUSH the written events go out with the
+    			next start of (micro)frame, the SOF interrupt closes the slot
+    			and starts the transfer. USB_MIDI_Flush() only marks the last
+    			event as complete.
+
     			Polling mode:
     			main () {
     				...
@@ -34,6 +40,7 @@
 #include "usb/nl_usb_midi.h"
 #include "usb/nl_usb_descmidi.h"
 #include "usb/nl_usb_core.h"
+#include "usb/nl_usb_midi_parser.h"
 
 #include "cmsis/LPC43xx.h"
 #include "spibb/nl_spi_bb.h"
@@ -41,16 +48,137 @@
 #include "drv/nl_dbg.h"
 #include "heartbeat/nl_heartbeat.h"
 
-static uint32_t endOfBuffer = 0;
 
-static uint8_t midiBuffer[2][USB_MIDI_BUFFER_SIZE];
-static uint8_t activeBuffer = 0;
-static uint32_t midiBuffPosition[2];
+/** tx ring: the events are written into the slot txFill, the slots
+ *  txTail ... txFill-1 are closed, txTail ... txSend-1 are queued on the
+ *  endpoint (up to USB_DTD_POOL_SIZE transfers in flight) */
+static uint8_t txRing[USB_MIDI_TX_SLOTS][USB_MIDI_BUFFER_SIZE] __attribute__((aligned(4)));
+static uint32_t txLen[USB_MIDI_TX_SLOTS];
+static uint32_t txFill = 0;						// free-running
+static uint32_t txSend = 0;						// free-running
+static uint32_t txTail = 0;						// free-running
+static USB_MIDI_TX_STATS_T txStats;
 
 static MidiRcvCallback USB_MIDI_RcvCallback = 0;
 
 static uint8_t midiDropMessages = 0;
 
+#if USB_MIDI_SOF_FLUSH
+static volatile uint8_t txOpen = 0;				// the last reserved event is not written yet (until the next Reserve or Flush)
+static volatile uint8_t sofMissed = 0;			// the SOF has found an open event, the writer closes the slot
+#endif
+
+static uint32_t USB_MIDI_CloseSlot(void);
+static uint32_t USB_MIDI_StartTransfers(void);
+
+
+/** rx ring: the endpoint is primed with the slot rxFill, the slots
+ *  rxTail ... rxFill-1 hold received data which is not processed yet */
+static uint8_t rxRing[USB_MIDI_RX_SLOTS][USB_MIDI_RX_SIZE] __attribute__((aligned(4)));
+static uint32_t rxLen[USB_MIDI_RX_SLOTS];
+static volatile uint32_t rxFill = 0;			// free-running, written by the interrupt only
+static volatile uint32_t rxTail = 0;			// free-running, written by the task only
+static volatile uint8_t rxFull = 0;				// no free slot, the host gets NAKs until the task releases one
+static volatile uint8_t rxDeferFailed = 0;		// the deferred queue was full, USB_MIDI_Poll calls USB_MIDI_Received
+static USB_MIDI_RX_STATS_T rxStats;
+
+
+/******************************************************************************/
+/** @brief		Primes endpoint 1 with the free slot rxFill
+*******************************************************************************/
+static void USB_MIDI_PrimeRx(void)
+{
+  USB_ReadReqEP(0x01, rxRing[rxFill % USB_MIDI_RX_SLOTS], USB_MIDI_RX_SIZE);
+}
+
+/******************************************************************************/
+/** @brief		Hands the received slots to the callback (task level), also
+ * 				called when there is nothing new
+*******************************************************************************/
+static void USB_MIDI_Received(uint32_t arg)
+{
+  uint32_t i;
+
+  while(rxTail != rxFill)
+  {
+    i = rxTail % USB_MIDI_RX_SLOTS;
+    if(USB_MIDI_RcvCallback)
+      USB_MIDI_RcvCallback(rxRing[i], rxLen[i]);
+    rxTail++;
+
+    if(rxFull)
+    {
+      USB_Core_Lock();
+      rxFull = 0;
+      USB_MIDI_PrimeRx();
+      USB_Core_EndpointNak(0x01, 1);
+      USB_Core_Unlock();
+    }
+  }
+}
+
+/******************************************************************************/
+/** @brief		Releases the slots of finished transfers, called with the
+ * 				USB interrupt locked
+*******************************************************************************/
+static void USB_MIDI_ReleaseSlots(void)
+{
+  txTail = txSend - USB_Core_PendingTransfers(0x82);
+}
+
+/******************************************************************************/
+/** @brief		Sends the next slots after an IN completion (task level),
+ * 				with USB_MIDI_SOF_FLUSH only the finished slots are released
+*******************************************************************************/
+static void USB_MIDI_TxComplete(uint32_t arg)
+{
+#if USB_MIDI_SOF_FLUSH
+  USB_Core_Lock();
+  USB_MIDI_ReleaseSlots();
+  USB_Core_Unlock();
+#else
+  USB_MIDI_CheckBuffer();
+#endif
+}
+
+#if USB_MIDI_SOF_FLUSH
+/******************************************************************************/
+/** @brief		Start of (micro)frame handler (interrupt): sends the events
+ * 				written since the last (micro)frame in one transfer. If a
+ * 				writer is in the middle of an event, the slot is closed when
+ * 				the event is complete.
+*******************************************************************************/
+static void USB_MIDI_SOF(void)
+{
+  if(!USB_Core_IsConfigured())
+    return;
+
+  if(txOpen)
+    sofMissed = 1;
+  else
+    USB_MIDI_CloseSlot();
+
+  if(USB_MIDI_StartTransfers())
+    txStats.frames++;
+}
+
+/******************************************************************************/
+/** @brief		The last reserved event is complete, closes the slot if the
+ * 				SOF has been missed (called with the USB interrupt locked)
+*******************************************************************************/
+static void USB_MIDI_Commit(void)
+{
+  txOpen = 0;
+
+  if(sofMissed)
+  {
+    sofMissed = 0;
+    USB_MIDI_CloseSlot();
+    if(USB_MIDI_StartTransfers())
+      txStats.frames++;
+  }
+}
+#endif
 
 /******************************************************************************/
 /** @brief		Endpoint 1 Callback
@@ -58,17 +186,33 @@ static uint8_t midiDropMessages = 0;
 *******************************************************************************/
 static void USB_EndPoint1(uint32_t event)
 {
-  static uint8_t outbuff[512];
-  uint32_t length;
+  uint32_t depth;
 
   switch(event)
   {
     case USB_EVT_OUT:
-      length = USB_ReadEP(0x01, outbuff);
-      if(USB_MIDI_RcvCallback)
-        USB_MIDI_RcvCallback(outbuff, length);
+      rxLen[rxFill % USB_MIDI_RX_SLOTS] = USB_ReadEP(0x01, rxRing[rxFill % USB_MIDI_RX_SLOTS]);
+      rxFill++;
+      if(!USB_Core_Defer(USB_MIDI_Received, 0))
+        rxDeferFailed = 1;
+      rxStats.transfers++;
+
+      depth = rxFill - rxTail;
+      if(depth > rxStats.maxDepth)
+        rxStats.maxDepth = depth;
+
+      if(depth < USB_MIDI_RX_SLOTS)
+        USB_MIDI_PrimeRx();                     // the next transfer goes into a fresh slot right away
+      else
+      {
+        rxFull = 1;
+        rxStats.full++;
+        USB_Core_EndpointNak(0x01, 0);          // no NAK interrupts while the host retries, until a slot is free
+      }
+      break;
     case USB_EVT_OUT_NAK:
-      USB_ReadReqEP(0x01, outbuff, 512);
+      if(!rxFull && !USB_Core_EndpointPrimed(0x01))
+        USB_MIDI_PrimeRx();
       break;
   }
 }
@@ -84,7 +228,7 @@ static void USB_EndPoint2(uint32_t event)
   {
     case USB_EVT_IN_NAK:
     case USB_EVT_IN:
-      USB_MIDI_CheckBuffer();
+      USB_Core_Defer(USB_MIDI_TxComplete, 0);
       break;
   }
 }
@@ -103,6 +247,9 @@ void USB_MIDI_Init(void)
   /** assign callbacks */
   USB_Core_Endpoint_Callback_Set(1, USB_EndPoint1);
   USB_Core_Endpoint_Callback_Set(2, USB_EndPoint2);
+#if USB_MIDI_SOF_FLUSH
+  USB_Core_SOF_Event_Handler_Set(USB_MIDI_SOF);
+#endif
   USB_Core_Init();
 }
 
@@ -117,11 +264,21 @@ void USB_MIDI_Config(MidiRcvCallback midircv)
 }
 
 /******************************************************************************/
-/** @brief    Function that polls USB MIDI driver
+/** @brief    Function that polls USB MIDI driver, in interrupt mode it only
+ *            executes the deferred callbacks
 *******************************************************************************/
 void USB_MIDI_Poll(void)
 {
+#if USB_POLLING
   USB0_IRQHandler();
+#endif
+  USB_Core_ProcessDeferred();
+
+  if(rxDeferFailed)
+  {
+    rxDeferFailed = 0;
+    USB_MIDI_Received(0);
+  }
 }
 
 /******************************************************************************/
@@ -133,6 +290,96 @@ uint32_t USB_MIDI_IsConfigured(void)
   return USB_Core_IsConfigured();
 }
 
+/******************************************************************************/
+/** @brief		Closes the slot which is filled, if the ring has room for it
+ * 				(called with the USB interrupt locked)
+    @return		1 - closed; 0 - empty or no free slot
+*******************************************************************************/
+static uint32_t USB_MIDI_CloseSlot(void)
+{
+  uint32_t depth;
+
+  if((txLen[txFill % USB_MIDI_TX_SLOTS] == 0) || ((txFill - txTail) >= (USB_MIDI_TX_SLOTS - 1)))
+    return 0;
+
+  txFill++;
+  txLen[txFill % USB_MIDI_TX_SLOTS] = 0;
+
+  depth = txFill - txTail;
+  if(depth > txStats.maxDepth)
+    txStats.maxDepth = depth;
+
+  return 1;
+}
+
+/******************************************************************************/
+/** @brief		Reserves bytes in the TX ring, a full slot is closed and sent
+ * 				(with USB_MIDI_SOF_FLUSH in the next (micro)frame). The
+ * 				previous reservation has to be written completely.
+    @param[in]	cnt		Amount of bytes (at most USB_MIDI_BUFFER_SIZE)
+    @return		Pointer to the reserved bytes - Success ; NULL - Failure
+*******************************************************************************/
+uint8_t* USB_MIDI_Reserve(uint32_t cnt)
+{
+  uint32_t i;
+  uint8_t* p = NULL;
+
+  if(midiDropMessages)
+  {
+    return NULL;
+  }
+
+  USB_Core_Lock();
+
+#if USB_MIDI_SOF_FLUSH
+  USB_MIDI_Commit();
+#endif
+
+  i = txFill % USB_MIDI_TX_SLOTS;
+
+  if(txLen[i] + cnt > USB_MIDI_BUFFER_SIZE)
+  {
+    if((cnt > USB_MIDI_BUFFER_SIZE) || !USB_MIDI_CloseSlot())
+    {
+      txStats.dropped += cnt;
+      USB_Core_Unlock();
+      return NULL;
+    }
+#if !USB_MIDI_SOF_FLUSH
+    USB_MIDI_StartTransfers();
+#endif
+    i = txFill % USB_MIDI_TX_SLOTS;
+  }
+
+  txLen[i] += cnt;
+  p = txRing[i] + txLen[i] - cnt;
+
+#if USB_MIDI_SOF_FLUSH
+  txOpen = 1;
+#endif
+
+  USB_Core_Unlock();
+
+  return p;
+}
+
+/******************************************************************************/
+/** @brief		Closes the slot which is filled and starts the transfer,
+ * 				if the endpoint is free. With USB_MIDI_SOF_FLUSH it only marks
+ * 				the last event as complete, the SOF sends it.
+*******************************************************************************/
+void USB_MIDI_Flush(void)
+{
+  USB_Core_Lock();
+#if USB_MIDI_SOF_FLUSH
+  USB_MIDI_Commit();
+#else
+  USB_MIDI_CloseSlot();
+  USB_MIDI_StartTransfers();
+#endif
+  USB_Core_Unlock();
+}
+
 /******************************************************************************/
 /** @brief		Send MIDI buffer
     @param[in]	buff	Pointer to data buffer
@@ -142,72 +389,105 @@ uint32_t USB_MIDI_IsConfigured(void)
 *******************************************************************************/
 uint32_t USB_MIDI_Send(uint8_t *buff, uint32_t cnt, uint8_t imm)
 {
-
-  if(midiDropMessages)
+  if(imm && ((txSend != txFill) || !USB_Core_ReadyToWrite(0x82)))
   {
     return 0;
   }
 
-  if(USB_Core_ReadyToWrite(0x82))
-  {
-    USB_WriteEP(0x82, buff, cnt);
-    endOfBuffer = (uint32_t) buff + cnt;
-    return cnt;
-  }
-  else if(!imm)
-  {
-    return USB_MIDI_SendDelayed(buff, cnt);
-  }
-  return 0;
+  cnt = USB_MIDI_SendDelayed(buff, cnt);
+  USB_MIDI_Flush();
+
+  return cnt;
 }
 
 /******************************************************************************/
-/** @brief		Write the data into buffer for delayed transfer
+/** @brief		Write the data into the TX ring for delayed transfer
     @param[in]	buff	Pointer to data buffer
     @param[in]	cnt		Amount of bytes to send
     @return		Number of bytes written - Success ; 0 - Failure
 *******************************************************************************/
 uint32_t USB_MIDI_SendDelayed(uint8_t *buff, uint32_t cnt)
 {
-  uint32_t i = 0;
-  if(midiDropMessages)
+  uint8_t* dest = USB_MIDI_Reserve(cnt);
+
+  if(dest == NULL)
   {
     return 0;
   }
-  while((midiBuffPosition[activeBuffer] < USB_MIDI_BUFFER_SIZE) && (i < cnt))
+  memcpy(dest, buff, cnt);
+  return cnt;
+}
+
+/******************************************************************************/
+/** @brief		Writes a SysEx message as event packets into the TX ring
+    @param[in]	data	F0 ... F7
+    @param[in]	len		Length of the message
+    @return		1 - Success ; 0 - Failure (the ring is full, the message may be cut)
+*******************************************************************************/
+uint32_t USB_MIDI_SendSysEx(uint8_t *data, uint32_t len)
+{
+  uint8_t* p;
+  uint32_t n;
+
+  while(len)
   {
-    midiBuffer[activeBuffer][midiBuffPosition[activeBuffer]] = buff[i];
-    i++;
-    midiBuffPosition[activeBuffer]++;
+    n = (len > 3) ? 3 : len;
+
+    p = USB_MIDI_Reserve(4);
+    if(!p)
+      return 0;
+
+    p[0] = (len > 3) ? USB_MIDI_CIN_SYSEX_START : (USB_MIDI_CIN_SYSEX_END_1 + n - 1);
+    p[1] = data[0];
+    p[2] = (n > 1) ? data[1] : 0;
+    p[3] = (n > 2) ? data[2] : 0;
+
+    data += n;
+    len -= n;
   }
-  return i;
+
+  return 1;
 }
 
 /******************************************************************************/
-/** @brief		Send out the current buffer
- 	@return		1 - Success; 0 - Failure
+/** @brief		Releases the slots of finished transfers and queues the closed
+ * 				slots on the endpoint, as long as it has free dTDs (called
+ * 				with the USB interrupt locked)
+ 	@return		1 - a transfer was started; 0 - none
 *******************************************************************************/
-uint32_t USB_MIDI_CheckBuffer(void)
+static uint32_t USB_MIDI_StartTransfers(void)
 {
-  if(midiBuffPosition[activeBuffer] && USB_Core_ReadyToWrite(0x82))
+  uint32_t i;
+  uint32_t ret = 0;
+
+  USB_MIDI_ReleaseSlots();
+
+  while((txSend != txFill) && USB_Core_ReadyToWrite(0x82))
   {
-    USB_WriteEP(0x82, midiBuffer[activeBuffer], midiBuffPosition[activeBuffer]);
-    endOfBuffer = (uint32_t) midiBuffer[activeBuffer] + midiBuffPosition[activeBuffer];
-    midiBuffPosition[activeBuffer] = 0;
-    activeBuffer = activeBuffer ? 0 : 1;
-    return 1;
+    i = txSend % USB_MIDI_TX_SLOTS;
+    USB_WriteEP(0x82, txRing[i], txLen[i]);
+    txSend++;
+    txStats.transfers++;
+    ret = 1;
   }
-  else
-    return 0;
+
+  return ret;
 }
 
 /******************************************************************************/
-/** @brief		Get the amount of bytes left to be sent
-    @return		Amount of bytes to be sent from the buffer
+/** @brief		Releases the slots of finished transfers and queues the closed
+ * 				slots on the endpoint, as long as it has free dTDs
+ 	@return		1 - Success; 0 - Failure
 *******************************************************************************/
-uint32_t USB_MIDI_BytesToSend(void)
+uint32_t USB_MIDI_CheckBuffer(void)
 {
-  return USB_Core_BytesToSend(endOfBuffer, 0x82);
+  uint32_t ret;
+
+  USB_Core_Lock();
+  ret = USB_MIDI_StartTransfers();
+  USB_Core_Unlock();
+
+  return ret;
 }
 
 /******************************************************************************/
@@ -217,6 +497,33 @@ uint32_t USB_MIDI_BytesToSend(void)
 void USB_MIDI_DropMessages(uint8_t drop)
 {
   midiDropMessages = drop;
+  if(drop)
+  {
+    USB_Core_Lock();
+    txFill = txSend;                    // nobody is listening: discarding the slots which are not on the endpoint yet
+    txLen[txFill % USB_MIDI_TX_SLOTS] = 0;
+#if USB_MIDI_SOF_FLUSH
+    txOpen = 0;
+    sofMissed = 0;
+#endif
+    USB_Core_Unlock();
+  }
+}
+
+/******************************************************************************/
+/** @brief		Counters of the TX ring
+*******************************************************************************/
+const USB_MIDI_TX_STATS_T* USB_MIDI_GetTxStats(void)
+{
+  return &txStats;
+}
+
+/******************************************************************************/
+/** @brief		Counters of the RX ring
+*******************************************************************************/
+const USB_MIDI_RX_STATS_T* USB_MIDI_GetRxStats(void)
+{
+  return &rxStats;
 }
 
 
@@ -17,8 +17,36 @@
  */
 /** MIDI buffer size */
 #define USB_MIDI_BUFFER_SIZE	1024
+/** number of slots in the TX ring */
+#define USB_MIDI_TX_SLOTS		4
+/** number of slots in the RX ring */
+#define USB_MIDI_RX_SLOTS		4
+/** size of a RX slot (max. packet size of the bulk endpoint) */
+#define USB_MIDI_RX_SIZE		512
+/** flush policy of the TX ring
+ *  0: USB_MIDI_Flush closes the slot and starts the transfer right away
+ *  1: the events written until the next start of (micro)frame go out
+ *     together, the SOF interrupt starts the transfer. USB_MIDI_Flush only
+ *     marks the last event as complete, an event which is still being
+ *     written at the SOF is sent by the next USB_MIDI_Reserve/Flush */
+#ifndef USB_MIDI_SOF_FLUSH
+#define USB_MIDI_SOF_FLUSH		1
+#endif
 /** @} */
 
+typedef struct {
+  uint32_t dropped;			/* bytes which did not fit into the ring */
+  uint32_t maxDepth;		/* maximum number of closed slots (waiting or on the endpoint) */
+  uint32_t transfers;		/* slots sent */
+  uint32_t frames;			/* (micro)frames in which transfers were started */
+} USB_MIDI_TX_STATS_T;
+
+typedef struct {
+  uint32_t transfers;		/* slots received */
+  uint32_t maxDepth;		/* maximum number of slots waiting for the callback */
+  uint32_t full;			/* ring ran full, the host got NAKs */
+} USB_MIDI_RX_STATS_T;
+
 /* Definition for Midi Receive Callback function */
 typedef void (*MidiRcvCallback)(uint8_t* buff, uint32_t len);
 
@@ -30,7 +58,11 @@ void USB_MIDI_Poll(void);
 uint32_t USB_MIDI_IsConfigured(void);
 uint32_t USB_MIDI_Send(uint8_t* buff, uint32_t cnt, uint8_t imm);
 uint32_t USB_MIDI_SendDelayed(uint8_t* buff, uint32_t cnt);
+uint32_t USB_MIDI_SendSysEx(uint8_t* data, uint32_t len);
 uint32_t USB_MIDI_CheckBuffer(void);
-uint32_t USB_MIDI_BytesToSend(void);
+uint8_t* USB_MIDI_Reserve(uint32_t cnt);
+void USB_MIDI_Flush(void);
+const USB_MIDI_TX_STATS_T* USB_MIDI_GetTxStats(void);
+const USB_MIDI_RX_STATS_T* USB_MIDI_GetRxStats(void);
 void USB_MIDI_DropMessages(uint8_t drop);
 #endif /* NL_USB_MIDI_H_ */
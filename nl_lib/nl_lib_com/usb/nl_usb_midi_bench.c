@@ -0,0 +1,192 @@
+/******************************************************************************/
+/** @file		nl_usb_midi_bench.c
+    @date		2026-10-19
+    @brief    	USB-MIDI loopback and throughput test (build flag USB_MIDI_BENCHMARK)
+    @example	USB_MIDI_BENCH_Init();									// after HBT_Init()
+    			COOS_Task_Add(USB_MIDI_BENCH_Process, 17, 8);			// every 1 ms
+    @ingroup	nl_drv_modules
+    @author		KSTR
+
+    The pings of the host are echoed as soon as the receive callback gets
+    them, so the round trip covers both directions of nl_usb_core.c, the
+    deferred work and the TX ring. The stream packets go through the same
+    USB_MIDI_Reserve() as the messages of nl_tcd_msg.c. The latency
+    percentiles and the loss of the LPC stream are evaluated by the host.
+*******************************************************************************/
+#include "usb/nl_usb_midi_bench.h"
+
+#if defined(USB_MIDI_BENCHMARK) && defined(CORE_M4)
+
+#include "usb/nl_usb_midi.h"
+#include "usb/nl_usb_midi_parser.h"
+#include "tcd/nl_tcd_msg.h"
+#include "cmsis/LPC43xx.h"
+
+#define USB_MIDI_BENCH_REPORT_MS	1000
+
+static uint32_t streamRate = 0;						// packets per ms
+static uint32_t streamLength = USB_MIDI_BENCH_MIN_LENGTH;
+static uint32_t streamSeq = 0;
+static uint32_t pingSeq = 0;						// next expected sequence number
+static uint32_t reportCnt = 0;
+
+static uint32_t rxBytes = 0;
+static uint32_t rxPackets = 0;
+static uint32_t rxLost = 0;
+static uint32_t txBytes = 0;
+static uint32_t txPackets = 0;
+static uint32_t txDropped = 0;
+
+
+static void USB_MIDI_BENCH_Put(uint8_t* p, uint32_t val, uint32_t groups)
+{
+  while(groups--)
+  {
+    *p++ = val & 0x7F;
+    val >>= 7;
+  }
+}
+
+static uint32_t USB_MIDI_BENCH_Get(uint8_t* p, uint32_t groups)
+{
+  uint32_t val = 0;
+
+  while(groups--)
+    val |= (uint32_t) (p[groups] & 0x7F) << (7 * groups);
+
+  return val;
+}
+
+/******************************************************************************/
+/** @brief    Writes a SysEx message into the TX ring, counts the drops
+*******************************************************************************/
+static uint32_t USB_MIDI_BENCH_SendSysEx(uint8_t* data, uint32_t len)
+{
+  if(USB_MIDI_SendSysEx(data, len))
+    return 1;
+
+  txDropped++;
+  return 0;
+}
+
+/******************************************************************************/
+/** @brief    Handler for the SysEx messages of the host (task level)
+*******************************************************************************/
+static void USB_MIDI_BENCH_Receive(uint8_t cable, uint8_t* data, uint32_t len)
+{
+  uint32_t seq;
+
+  if((len < 4) || (data[1] != USB_MIDI_BENCH_ID))
+    return;
+
+  rxBytes += len;
+  rxPackets++;
+
+  switch(data[2])
+  {
+    case USB_MIDI_BENCH_PING:
+      if(len < USB_MIDI_BENCH_MIN_LENGTH)
+        return;
+      seq = USB_MIDI_BENCH_Get(data + 3, 3);
+      rxLost += (seq - pingSeq) & 0x1FFFFF;		// 21-bit sequence numbers
+      pingSeq = (seq + 1) & 0x1FFFFF;
+
+      data[2] = USB_MIDI_BENCH_ECHO;			// the parser buffer is ours until we return
+      if(USB_MIDI_BENCH_SendSysEx(data, len))
+      {
+        txBytes += len;
+        txPackets++;
+      }
+      USB_MIDI_Flush();
+      break;
+
+    case USB_MIDI_BENCH_CONFIG:
+      if(len < 6)
+        return;
+      streamRate = (data[3] > USB_MIDI_BENCH_MAX_RATE) ? USB_MIDI_BENCH_MAX_RATE : data[3];
+      streamLength = data[4] * 2;				// 7 bits: in steps of 2 bytes
+      if(streamLength < USB_MIDI_BENCH_MIN_LENGTH)
+        streamLength = USB_MIDI_BENCH_MIN_LENGTH;
+      if(streamLength > USB_MIDI_BENCH_MAX_LENGTH)
+        streamLength = USB_MIDI_BENCH_MAX_LENGTH;
+      streamSeq = 0;
+      pingSeq = 0;
+      rxBytes = rxPackets = rxLost = 0;
+      txBytes = txPackets = txDropped = 0;
+      reportCnt = 0;
+      break;
+  }
+}
+
+/******************************************************************************/
+/** @brief    Starts the cycle counter (free running, shared with MSG_GetTime)
+ *            and takes over the SysEx messages
+*******************************************************************************/
+void USB_MIDI_BENCH_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  USB_MIDI_PARSER_SetSysExHandler(USB_MIDI_BENCH_Receive);
+}
+
+/******************************************************************************/
+/** @brief    Sends the stream packets and the report (COOS task, every 1 ms)
+*******************************************************************************/
+void USB_MIDI_BENCH_Process(void)
+{
+  static uint8_t msg[USB_MIDI_BENCH_MAX_LENGTH];
+  uint32_t i;
+
+  if(!USB_MIDI_IsConfigured())
+    return;
+
+  if(streamRate)
+  {
+    msg[0] = 0xF0;
+    msg[1] = USB_MIDI_BENCH_ID;
+    msg[2] = USB_MIDI_BENCH_STREAM;
+    for(i = 11; i < streamLength - 1; i++)
+      msg[i] = i & 0x7F;
+    msg[streamLength - 1] = 0xF7;
+
+    for(i = 0; i < streamRate; i++)
+    {
+      USB_MIDI_BENCH_Put(msg + 3, streamSeq, 3);
+      USB_MIDI_BENCH_Put(msg + 6, MSG_GetTime(), 5);
+      streamSeq = (streamSeq + 1) & 0x1FFFFF;	// a dropped packet shows up as a gap at the host
+
+      if(!USB_MIDI_BENCH_SendSysEx(msg, streamLength))
+        break;
+
+      txBytes += streamLength;
+      txPackets++;
+    }
+  }
+
+  if(++reportCnt >= USB_MIDI_BENCH_REPORT_MS)
+  {
+    reportCnt = 0;
+
+    msg[0] = 0xF0;
+    msg[1] = USB_MIDI_BENCH_ID;
+    msg[2] = USB_MIDI_BENCH_REPORT;
+    USB_MIDI_BENCH_Put(msg + 3, rxBytes, 5);
+    USB_MIDI_BENCH_Put(msg + 8, rxPackets, 5);
+    USB_MIDI_BENCH_Put(msg + 13, rxLost, 5);
+    USB_MIDI_BENCH_Put(msg + 18, txBytes, 5);
+    USB_MIDI_BENCH_Put(msg + 23, txPackets, 5);
+    USB_MIDI_BENCH_Put(msg + 28, txDropped, 5);
+    msg[33] = 0xF7;
+    USB_MIDI_BENCH_SendSysEx(msg, 34);
+
+    rxBytes = rxPackets = rxLost = 0;
+    txBytes = txPackets = txDropped = 0;
+  }
+
+  USB_MIDI_Flush();
+}
+
+#endif
+
+// EOF
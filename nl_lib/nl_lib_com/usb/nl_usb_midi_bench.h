@@ -0,0 +1,44 @@
+/******************************************************************************/
+/** @file		nl_usb_midi_bench.h
+    @date		2026-10-19
+    @brief    	USB-MIDI loopback and throughput test (build flag USB_MIDI_BENCHMARK)
+    @example
+    @ingroup  	nl_drv_modules
+    @author		KSTR
+
+    SysEx protocol with the host tool tools/usb_midi_bench (ID 0x7D, non-commercial),
+    all numbers in 7-bit groups, least significant group first:
+      host -> LPC  F0 7D 01 seq[3] hostTime[5] padding F7				ping
+      LPC -> host  F0 7D 02 seq[3] hostTime[5] padding F7				echo of the ping
+      LPC -> host  F0 7D 03 seq[3] lpcTime[5] padding F7				stream packet
+      host -> LPC  F0 7D 10 packetsPerMs length/2 F7					stream config (0: off)
+      LPC -> host  F0 7D 11 rxBytes[5] rxPackets[5] rxLost[5]
+                            txBytes[5] txPackets[5] txDropped[5] F7		report, once per second
+    Times in us, pings and the config are limited to USB_MIDI_SYSEX_SIZE bytes.
+*******************************************************************************/
+
+#ifndef NL_USB_MIDI_BENCH_H_
+#define NL_USB_MIDI_BENCH_H_
+
+#include <stdint.h>
+
+#if defined(USB_MIDI_BENCHMARK) && defined(CORE_M4)
+
+#define USB_MIDI_BENCH_ID			0x7D
+
+#define USB_MIDI_BENCH_PING			0x01
+#define USB_MIDI_BENCH_ECHO			0x02
+#define USB_MIDI_BENCH_STREAM		0x03
+#define USB_MIDI_BENCH_CONFIG		0x10
+#define USB_MIDI_BENCH_REPORT		0x11
+
+#define USB_MIDI_BENCH_MAX_RATE		32			// stream packets per ms
+#define USB_MIDI_BENCH_MIN_LENGTH	12			// F0 7D cmd seq[3] time[5] F7
+#define USB_MIDI_BENCH_MAX_LENGTH	254			// length/2 in one data byte of the config
+
+void USB_MIDI_BENCH_Init(void);
+void USB_MIDI_BENCH_Process(void);
+
+#endif
+
+#endif /* NL_USB_MIDI_BENCH_H_ */
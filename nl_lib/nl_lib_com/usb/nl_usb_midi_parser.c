@@ -0,0 +1,201 @@
+/******************************************************************************/
+/** @file		nl_usb_midi_parser.c
+    @date		2026-10-19
+    @brief    	Parser for the USB-MIDI 1.0 event packets received from the host
+    @example	USB_MIDI_PARSER_Init();
+    			USB_MIDI_PARSER_SetChannelHandler(0xA0, HeartBeatHandler);
+    			USB_MIDI_Config(USB_MIDI_PARSER_Parse);
+    @ingroup	nl_drv_modules
+    @author		KSTR
+
+    Every event packet has 4 bytes: cable number and Code Index Number (CIN)
+    in byte 0, the MIDI message in bytes 1 ... 3. The events are dispatched by
+    their status byte, SysEx messages are collected and dispatched when complete.
+*******************************************************************************/
+#include <string.h>
+#include "usb/nl_usb_midi_parser.h"
+
+/** MIDI bytes per CIN (0: reserved) */
+static const uint8_t cinLength[16] = {0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1};
+
+/** handlers for the status bytes 0x80 ... 0xFF */
+static MidiEventHandler eventHandler[128];
+static MidiSysExHandler sysexHandler = 0;
+
+static uint8_t sysexBuff[USB_MIDI_SYSEX_SIZE];
+static uint32_t sysexLen = 0;
+static uint8_t sysexOverflow = 0;
+
+static USB_MIDI_PARSER_STATS_T stats;
+
+
+/******************************************************************************/
+/** @brief    Removes all handlers and resets the counters
+*******************************************************************************/
+void USB_MIDI_PARSER_Init(void)
+{
+  memset(eventHandler, 0, sizeof(eventHandler));
+  memset(&stats, 0, sizeof(stats));
+  sysexHandler = 0;
+  sysexLen = 0;
+  sysexOverflow = 0;
+}
+
+/******************************************************************************/
+/** @brief    Sets the handler for one status byte
+    @param[in]	status		0x80 ... 0xFF (channel messages: one channel only)
+    @param[in]	handler		Function to be called, 0 to remove the handler
+*******************************************************************************/
+void USB_MIDI_PARSER_SetHandler(uint8_t status, MidiEventHandler handler)
+{
+  if(status & 0x80)
+    eventHandler[status & 0x7F] = handler;
+}
+
+/******************************************************************************/
+/** @brief    Sets the handler for a channel message on all 16 channels
+    @param[in]	status		0x80 ... 0xE0
+    @param[in]	handler		Function to be called, 0 to remove the handler
+*******************************************************************************/
+void USB_MIDI_PARSER_SetChannelHandler(uint8_t status, MidiEventHandler handler)
+{
+  uint32_t i;
+
+  if((status & 0x80) && (status < 0xF0))
+  {
+    for(i = 0; i < 16; i++)
+      eventHandler[((status & 0xF0) | i) & 0x7F] = handler;
+  }
+}
+
+/******************************************************************************/
+/** @brief    Sets the handler for complete SysEx messages
+    @param[in]	handler		Function to be called, 0 to remove the handler
+*******************************************************************************/
+void USB_MIDI_PARSER_SetSysExHandler(MidiSysExHandler handler)
+{
+  sysexHandler = handler;
+}
+
+/******************************************************************************/
+/** @brief    Collects the bytes of a SysEx message
+    @param[in]	cable	Cable number
+    @param[in]	data	MIDI bytes of the event packet
+    @param[in]	cnt		Number of MIDI bytes
+    @param[in]	end		1 - last packet of the message
+*******************************************************************************/
+static void USB_MIDI_PARSER_SysEx(uint8_t cable, uint8_t* data, uint32_t cnt, uint32_t end)
+{
+  if(data[0] == 0xF0)
+  {
+    sysexLen = 0;								// start of a message, discarding an unterminated one
+    sysexOverflow = 0;
+  }
+
+  if(sysexLen + cnt > USB_MIDI_SYSEX_SIZE)
+    sysexOverflow = 1;
+  else
+  {
+    memcpy(sysexBuff + sysexLen, data, cnt);
+    sysexLen += cnt;
+  }
+
+  if(!end)
+    return;
+
+  if(sysexOverflow)
+    stats.sysexOverflow++;
+  else if(sysexHandler)
+    sysexHandler(cable, sysexBuff, sysexLen);
+  else
+    stats.unhandled++;
+
+  sysexLen = 0;
+  sysexOverflow = 0;
+}
+
+/******************************************************************************/
+/** @brief    Parses the received event packets (MidiRcvCallback)
+    @param[in]	buff	Pointer to data buffer
+    @param[in]	len		Amount of bytes in buffer (multiple of 4)
+*******************************************************************************/
+void USB_MIDI_PARSER_Parse(uint8_t* buff, uint32_t len)
+{
+  uint8_t cin;
+  uint8_t cable;
+  uint8_t status;
+  MidiEventHandler handler;
+
+  for(; len >= 4; len -= 4, buff += 4)
+  {
+    cin = buff[0] & 0x0F;
+    cable = buff[0] >> 4;
+    status = buff[1];
+
+    stats.packets++;
+
+    switch(cin)
+    {
+      case USB_MIDI_CIN_MISC:
+      case USB_MIDI_CIN_CABLE_EVENT:
+        stats.invalid++;
+        continue;
+
+      case USB_MIDI_CIN_SYSEX_START:
+        USB_MIDI_PARSER_SysEx(cable, buff + 1, 3, 0);
+        continue;
+
+      case USB_MIDI_CIN_SYSEX_END_1:
+        if(status == 0xF7)
+        {
+          USB_MIDI_PARSER_SysEx(cable, buff + 1, 1, 1);
+          continue;
+        }
+        break;									// single-byte System Common
+
+      case USB_MIDI_CIN_SYSEX_END_2:
+      case USB_MIDI_CIN_SYSEX_END_3:
+        USB_MIDI_PARSER_SysEx(cable, buff + 1, cinLength[cin], 1);
+        continue;
+
+      case USB_MIDI_CIN_SYSCOM_2:
+      case USB_MIDI_CIN_SYSCOM_3:
+      case USB_MIDI_CIN_SINGLE_BYTE:
+        break;
+
+      default:									// channel voice messages
+        if((status >> 4) != cin)
+        {
+          stats.invalid++;
+          continue;
+        }
+        break;
+    }
+
+    if(!(status & 0x80))
+    {
+      stats.invalid++;
+      continue;
+    }
+
+    handler = eventHandler[status & 0x7F];
+
+    if(handler)
+      handler(cable, status,
+              (cinLength[cin] > 1) ? buff[2] : 0,
+              (cinLength[cin] > 2) ? buff[3] : 0);
+    else
+      stats.unhandled++;
+  }
+}
+
+/******************************************************************************/
+/** @brief		Counters of the parser
+*******************************************************************************/
+const USB_MIDI_PARSER_STATS_T* USB_MIDI_PARSER_GetStats(void)
+{
+  return &stats;
+}
+
+
+// EOF
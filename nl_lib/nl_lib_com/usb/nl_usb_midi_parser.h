@@ -0,0 +1,60 @@
+/******************************************************************************/
+/** @file		nl_usb_midi_parser.h
+    @date		2026-10-19
+    @brief    	Parser for the USB-MIDI 1.0 event packets received from the host
+    @example
+    @ingroup  	nl_drv_modules
+    @author		KSTR
+*******************************************************************************/
+
+#ifndef NL_USB_MIDI_PARSER_H_
+#define NL_USB_MIDI_PARSER_H_
+
+#include <stdint.h>
+
+/** USB MIDI parser configuration block
+ * @{
+ */
+/** maximum length of a SysEx message (including F0 and F7) */
+#define USB_MIDI_SYSEX_SIZE		64
+/** @} */
+
+/** Code Index Numbers (USB-MIDI 1.0, chapter 4) */
+#define USB_MIDI_CIN_MISC			0x0
+#define USB_MIDI_CIN_CABLE_EVENT	0x1
+#define USB_MIDI_CIN_SYSCOM_2		0x2
+#define USB_MIDI_CIN_SYSCOM_3		0x3
+#define USB_MIDI_CIN_SYSEX_START	0x4
+#define USB_MIDI_CIN_SYSEX_END_1	0x5		// or single-byte System Common
+#define USB_MIDI_CIN_SYSEX_END_2	0x6
+#define USB_MIDI_CIN_SYSEX_END_3	0x7
+#define USB_MIDI_CIN_NOTE_OFF		0x8
+#define USB_MIDI_CIN_NOTE_ON		0x9
+#define USB_MIDI_CIN_POLY_KEYPRESS	0xA
+#define USB_MIDI_CIN_CONTROL_CHANGE	0xB
+#define USB_MIDI_CIN_PROGRAM_CHANGE	0xC
+#define USB_MIDI_CIN_CHANNEL_PRESS	0xD
+#define USB_MIDI_CIN_PITCH_BEND		0xE
+#define USB_MIDI_CIN_SINGLE_BYTE	0xF
+
+typedef struct {
+  uint32_t packets;			/* event packets parsed */
+  uint32_t unhandled;		/* valid events without a handler */
+  uint32_t invalid;			/* reserved CINs, CIN and status not matching */
+  uint32_t sysexOverflow;	/* SysEx messages longer than USB_MIDI_SYSEX_SIZE */
+} USB_MIDI_PARSER_STATS_T;
+
+/* Handler for a MIDI event (channel voice, system common, real time) */
+typedef void (*MidiEventHandler)(uint8_t cable, uint8_t status, uint8_t data1, uint8_t data2);
+/* Handler for a complete SysEx message */
+typedef void (*MidiSysExHandler)(uint8_t cable, uint8_t* data, uint32_t len);
+
+/* USB MIDI parser functions */
+void USB_MIDI_PARSER_Init(void);
+void USB_MIDI_PARSER_SetHandler(uint8_t status, MidiEventHandler handler);
+void USB_MIDI_PARSER_SetChannelHandler(uint8_t status, MidiEventHandler handler);
+void USB_MIDI_PARSER_SetSysExHandler(MidiSysExHandler handler);
+void USB_MIDI_PARSER_Parse(uint8_t* buff, uint32_t len);
+const USB_MIDI_PARSER_STATS_T* USB_MIDI_PARSER_GetStats(void);
+
+#endif /* NL_USB_MIDI_PARSER_H_ */
@@ -0,0 +1,266 @@
+/******************************************************************************/
+/** @file		tcd_compact_decode.c
+    @brief    	host tool: reference decoder of the compact TCD wire format
+    @author		ssc
+
+    With MSG_FORMAT_COMPACT (nl_tcd_msg.h) the LPC combines P + D/DS,
+    KV + DS + KD (note-on) and KV + KU (note-off) into messages on status
+    bytes which the MIDI format does not use. Decode() turns them back into
+    the messages of MSG_FORMAT_MIDI, so a receiver can keep its existing
+    TCD parser behind it. Messages of the MIDI format pass unchanged.
+
+    build and run (from the repository root):
+      gcc -O2 -o tcd_compact_decode tools/tcd_compact/tcd_compact_decode.c
+      amidi -p hw:1,0,0 -d | ./tcd_compact_decode		decodes a dump (hex bytes),
+      													prints the sizes of both formats
+      ./tcd_compact_decode -t							self test with known messages
+
+    Negotiation: the ePC sends F0 7D 20 01 F7, the LPC answers F0 7D 21 01 F7
+    and uses the compact format from then on (F0 7D 20 00 F7: back to MIDI).
+    Adding 02 to the format (F0 7D 20 03 F7) turns on the timestamps, which
+    pass unchanged and are printed as the LPC time in us.
+    After a USB disconnect the LPC starts in the MIDI format again.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CMP_P_D			0x88		// same as in nl_tcd_msg.h
+#define CMP_P_DS		0xB8
+#define CMP_NOTE_ON_A	0xE0
+#define CMP_NOTE_ON_B	0xE8
+#define CMP_NOTE_OFF	0x98
+#define TIMESTAMP		0xA8		// 0xA8 ... 0xAB
+
+
+typedef struct
+{
+	uint8_t status;
+	uint8_t data1;
+	uint8_t data2;
+} EVENT_T;
+
+
+typedef struct
+{
+	uint32_t lastP;					// Id of the last P message
+	uint32_t noteOnA;				// 17 bits of MSG_CMP_NOTE_ON_A, waiting for B
+	int haveNoteOnA;
+} DECODER_T;
+
+
+static uint32_t Emit(EVENT_T* ev, uint8_t status, uint32_t value)
+{
+	ev->status = status;
+	ev->data1 = (value >> 7) & 0x7F;
+	ev->data2 = value & 0x7F;
+	return 1;
+}
+
+
+/*****************************************************************************
+* @brief	Decode - one MIDI message of the LPC
+* @param	ev: returns the messages of the MIDI format (up to 3)
+* @return	number of messages, 0 for the first half of a note-on
+******************************************************************************/
+
+static uint32_t Decode(DECODER_T* dec, uint8_t status, uint8_t data1, uint8_t data2, EVENT_T* ev)
+{
+	uint32_t value = ((uint32_t) (status & 0x07) << 14) | ((uint32_t) data1 << 7) | data2;
+	uint32_t n;
+
+	switch (status & 0xF8)
+	{
+		case CMP_P_D:
+			dec->lastP += (value >> 14) + 1;
+			n = Emit(ev, 0x81, dec->lastP);								// P
+			n += Emit(ev + n, 0x85, value & 0x3FFF);					// D
+			return n;
+
+		case CMP_P_DS:
+			dec->lastP += (value >> 14) + 1;
+			n = Emit(ev, 0x81, dec->lastP);								// P
+			n += Emit(ev + n, 0x95, value & 0x3FFF);					// DS (sign in bit 13)
+			return n;
+
+		case CMP_NOTE_ON_A:
+			dec->noteOnA = value;
+			dec->haveNoteOnA = 1;
+			return 0;
+
+		case CMP_NOTE_ON_B:
+			if (!dec->haveNoteOnA)
+			{
+				return 0;												// lost first half
+			}
+			dec->haveNoteOnA = 0;
+			n = Emit(ev, 0xB7, dec->noteOnA >> 11);						// KV
+			n += Emit(ev + n, 0x95, (((dec->noteOnA >> 10) & 1) << 13)	// DS
+								   | ((dec->noteOnA & 0x3FF) << 3) | (value >> 12));
+			n += Emit(ev + n, 0x97, value & 0xFFF);						// KD
+			return n;
+
+		case CMP_NOTE_OFF:
+			n = Emit(ev, 0xB7, (value >> 12) << 1);						// KV
+			n += Emit(ev + n, 0x87, value & 0xFFF);						// KU
+			return n;
+	}
+
+	if (status == 0x81)
+	{
+		dec->lastP = value & 0x3FFF;
+	}
+
+	ev->status = status;												// MIDI format
+	ev->data1 = data1;
+	ev->data2 = data2;
+	return 1;
+}
+
+
+/*****************************************************************************
+* @brief	Self_Test - messages of nl_tcd_msg.c in both formats
+******************************************************************************/
+
+typedef struct
+{
+	const char* name;
+	uint8_t compact[4][3];
+	uint32_t compactNum;
+	uint8_t midi[6][3];
+	uint32_t midiNum;
+} TEST_T;
+
+static const TEST_T tests[] =
+{
+	{ "note-on: KV 14, DS -2400, KD 3000",
+	  { {0xE1, 0x6A, 0x2C}, {0xE8, 0x17, 0x38} }, 2,
+	  { {0xB7, 0x00, 0x0E}, {0x95, 0x52, 0x60}, {0x97, 0x17, 0x38} }, 3 },
+	{ "time 40000 us, note-on (as above)",
+	  { {0xAA, 0x38, 0x40}, {0xE1, 0x6A, 0x2C}, {0xE8, 0x17, 0x38} }, 3,
+	  { {0xAA, 0x38, 0x40}, {0xB7, 0x00, 0x0E}, {0x95, 0x52, 0x60}, {0x97, 0x17, 0x38} }, 4 },
+	{ "note-off: KV 14, KU 1000",
+	  { {0x99, 0x67, 0x68} }, 1,
+	  { {0xB7, 0x00, 0x0E}, {0x87, 0x07, 0x68} }, 2 },
+	{ "P 100 (MIDI), P 103 + D 9876",
+	  { {0x81, 0x00, 0x64}, {0x88 | 0x02, 0x4D, 0x14} }, 2,
+	  { {0x81, 0x00, 0x64}, {0x81, 0x00, 0x67}, {0x85, 0x4D, 0x14} }, 3 },
+	{ "P 103 (MIDI), P 110 + DS -700",
+	  { {0x81, 0x00, 0x67}, {0xB8 | 0x06, 0x45, 0x3C} }, 2,
+	  { {0x81, 0x00, 0x67}, {0x81, 0x00, 0x6E}, {0x95, 0x45, 0x3C} }, 3 },
+};
+
+
+static int Self_Test(void)
+{
+	uint32_t t;
+	uint32_t i;
+	int failed = 0;
+
+	for (t = 0; t < sizeof(tests) / sizeof(tests[0]); t++)
+	{
+		DECODER_T dec = { 0x3FFF, 0, 0 };
+		EVENT_T ev[8];
+		uint32_t n = 0;
+
+		for (i = 0; i < tests[t].compactNum; i++)
+		{
+			n += Decode(&dec, tests[t].compact[i][0], tests[t].compact[i][1], tests[t].compact[i][2], ev + n);
+		}
+
+		int ok = (n == tests[t].midiNum);
+
+		for (i = 0; ok && (i < n); i++)
+		{
+			ok = (ev[i].status == tests[t].midi[i][0]) && (ev[i].data1 == tests[t].midi[i][1]) && (ev[i].data2 == tests[t].midi[i][2]);
+		}
+
+		printf("%-36s %s   MIDI %2u bytes   compact %2u bytes\n",
+			   tests[t].name, ok ? "ok    " : "FAILED", tests[t].midiNum * 4, tests[t].compactNum * 4);
+
+		failed |= !ok;
+	}
+
+	return failed;
+}
+
+
+/*****************************************************************************
+* @brief	main - decodes a hex dump of the MIDI bytes ("amidi -d")
+******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+	DECODER_T dec = { 0x3FFF, 0, 0 };
+	EVENT_T ev[3];
+	uint8_t msg[3];
+	uint32_t len = 0;
+	int inSysEx = 0;
+	unsigned int byte;
+	uint32_t inBytes = 0;
+	uint32_t outBytes = 0;
+	uint32_t i;
+	uint32_t n;
+
+	if ((argc > 1) && !strcmp(argv[1], "-t"))
+	{
+		return Self_Test();
+	}
+
+	while (scanf("%x", &byte) == 1)
+	{
+		if (byte == 0xF0)
+		{
+			inSysEx = 1;
+			printf("SysEx:");
+		}
+
+		if (inSysEx)
+		{
+			printf(" %02X", byte);
+			if (byte == 0xF7)
+			{
+				inSysEx = 0;
+				printf("\n");
+			}
+			continue;
+		}
+
+		if (byte & 0x80)
+		{
+			len = 0;
+		}
+
+		if (len < 3)
+		{
+			msg[len++] = byte;
+		}
+
+		if (len == 3)													// the TCD uses 3-byte messages only
+		{
+			n = Decode(&dec, msg[0], msg[1], msg[2], ev);
+
+			for (i = 0; i < n; i++)
+			{
+				if ((ev[i].status & 0xFC) == TIMESTAMP)
+				{
+					printf("%02X %02X %02X   time %u us\n", ev[i].status, ev[i].data1, ev[i].data2,
+						   ((ev[i].status & 0x03) << 14) | (ev[i].data1 << 7) | ev[i].data2);
+				}
+				else
+				{
+					printf("%02X %02X %02X\n", ev[i].status, ev[i].data1, ev[i].data2);
+				}
+			}
+
+			inBytes += 4;
+			outBytes += n * 4;
+			len = 0;
+		}
+	}
+
+	fprintf(stderr, "%u USB bytes received, %u in the MIDI format\n", inBytes, outBytes);
+
+	return 0;
+}
@@ -0,0 +1,338 @@
+/******************************************************************************/
+/** @file		gen_tcd_tables.c
+    @brief    	host tool: generates nl_lib_com/tcd/nl_tcd_tables.c
+    @author		ssc
+
+    The exponential time table, the velocity curves and the bender and
+    aftertouch curves of the TCD used to be computed by the M4 at start-up
+    and on every curve setting. This tool runs the same formulas on the
+    build host (the curves in single precision like on the M4, the
+    exponential table in double precision) and writes the results as
+    const tables, which end up in the flash of the LPC.
+
+    build and run (from the repository root):
+      gcc -O2 -o gen_tcd_tables tools/tcd_tables/gen_tcd_tables.c -lm
+      ./gen_tcd_tables > nl_lib/nl_lib_com/tcd/nl_tcd_tables.c
+
+    The exponential table is written for all supported segment widths,
+    EXPON_SEGMENT_SHIFT (nl_tcd_tables.h) selects one of them at build time.
+    "./gen_tcd_tables -r" prints the accuracy of each segment width to stderr.
+
+    The generated file is checked in, so the LPCXpresso build does not
+    depend on this tool. Run it again after changing a formula below.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define TIME_UNIT_MS	0.0208333		// a sample period of 48 kHz [in ms], same as in nl_tcd_expon.h
+
+#define NUM_VEL_CURVES		5
+#define VEL_TABLE_SIZE		65
+#define NUM_HW_CURVES		3
+#define HW_TABLE_SIZE		33
+
+#define EXPON_MIN_SHIFT		4		// 1000 segments
+#define EXPON_MAX_SHIFT		7		// 125 segments
+#define EXPON_FRACT_BITS	12		// same as in nl_tcd_tables.h
+
+
+static uint32_t expTime[(16000 >> EXPON_MIN_SHIFT) + 1];
+static uint32_t velTable[NUM_VEL_CURVES][VEL_TABLE_SIZE];
+static uint32_t benderTable[NUM_HW_CURVES][HW_TABLE_SIZE];
+static uint32_t atTable[NUM_HW_CURVES][HW_TABLE_SIZE];
+
+
+/*****************************************************************************
+* @brief	Expon_Exact - 0.1 ... 16000 ms on an exponential scale for paramVal 0 ... 16000,
+*			returned as a multiple of TIME_UNIT_MS
+******************************************************************************/
+
+static double Expon_Exact(double paramVal)
+{
+	return exp(log(0.1) + (paramVal / 16000.0) * (log(16000.0) - log(0.1))) / TIME_UNIT_MS;
+}
+
+
+/*****************************************************************************
+* @brief	Gen_Expon - table for one segment width (1 << shift), upscaled by 2^EXPON_FRACT_BITS
+*			element i holds the time for paramVal = i << shift
+******************************************************************************/
+
+static void Gen_Expon(uint32_t shift)
+{
+	uint32_t i;
+
+	for (i = 0; i <= (16000u >> shift); i++)
+	{
+		expTime[i] = (uint32_t)(Expon_Exact(i << shift) * (1 << EXPON_FRACT_BITS) + 0.5);
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Gen_ExponLinSlope - slope of the linear segment between paramVal 0 and 160,
+*			upscaled by 2^(EXPON_FRACT_BITS + 16)
+******************************************************************************/
+
+static uint32_t Gen_ExponLinSlope(void)
+{
+	return (uint32_t)(Expon_Exact(160.0) * (1 << EXPON_FRACT_BITS) * 65536.0 / 160.0 + 0.5);
+}
+
+
+/*****************************************************************************
+* @brief	Expon_Time - same integer math as EXPON_Time() in nl_tcd_expon.c
+******************************************************************************/
+
+static uint32_t Expon_Time(const uint32_t* table, uint32_t shift, uint32_t linSlope, int32_t paramVal)
+{
+	uint32_t segments = 16000 >> shift;
+
+	if (paramVal <= 0)
+	{
+		return 0;
+	}
+	else if (paramVal < 160)
+	{
+		return (paramVal * linSlope + (1 << (EXPON_FRACT_BITS + 15))) >> (EXPON_FRACT_BITS + 16);
+	}
+	else if (paramVal >= 16000)
+	{
+		return (table[segments] + (1 << (EXPON_FRACT_BITS - 1))) >> EXPON_FRACT_BITS;
+	}
+	else
+	{
+		uint32_t index = paramVal >> shift;
+		uint32_t fract = paramVal & ((1 << shift) - 1);
+		uint32_t t = table[index] + (uint32_t)(((uint64_t)(table[index + 1] - table[index]) * fract) >> shift);
+
+		return (t + (1 << (EXPON_FRACT_BITS - 1))) >> EXPON_FRACT_BITS;
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Report_Expon - accuracy of all segment widths for paramVal 160 ... 16000
+*			interpolation error: relative error before rounding to whole samples
+*			output error: deviation of the result in samples
+******************************************************************************/
+
+static void Report_Expon(void)
+{
+	uint32_t linSlope = Gen_ExponLinSlope();
+	uint32_t shift;
+	int32_t p;
+
+	fprintf(stderr, "shift  segments  table bytes  max. interpolation error  max. output error [samples]\n");
+
+	for (shift = EXPON_MIN_SHIFT; shift <= EXPON_MAX_SHIFT; shift++)
+	{
+		uint32_t segments = 16000 >> shift;
+		double maxRel = 0.0;
+		double maxAbs = 0.0;
+
+		Gen_Expon(shift);
+
+		for (p = 160; p <= 16000; p++)
+		{
+			double exact = Expon_Exact(p);
+			uint32_t index = ((uint32_t)p >> shift) < segments ? ((uint32_t)p >> shift) : segments - 1;		// p >= 160
+			double fract = (double)(p - (int32_t)(index << shift)) / (1 << shift);
+			double interp = (expTime[index] * (1.0 - fract) + expTime[index + 1] * fract) / (1 << EXPON_FRACT_BITS);
+			double rel = fabs(interp - exact) / exact;
+			double err = fabs((double)Expon_Time(expTime, shift, linSlope, p) - exact);
+
+			if (rel > maxRel)
+			{
+				maxRel = rel;
+			}
+
+			if (err > maxAbs)
+			{
+				maxAbs = err;
+			}
+		}
+
+		fprintf(stderr, "%5u  %8u  %11u  %21.4f ppm  %26.3f\n", shift, segments, (segments + 1) * 4, maxRel * 1e6, maxAbs);
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Gen_Velocity - hyperbolic curves from 4096 (shortest time) to 0 (longest time)
+*			curve 0 ... 4: very soft ... very hard
+******************************************************************************/
+
+static void Gen_Velocity(void)
+{
+	static const float b_curve[NUM_VEL_CURVES] = { 0.125, 0.25, 0.5, 1.0, 2.0 };	// b defines the curve shape
+
+	float vel_max = 4096.0;	// the hyperbola goes from vel_max (at 0) to 0 (at i_max)
+	float b;
+
+	uint32_t i_max = VEL_TABLE_SIZE - 1;
+	uint32_t c;
+	uint32_t i;
+
+	for (c = 0; c < NUM_VEL_CURVES; c++)
+	{
+		b = b_curve[c];
+
+		for (i = 0; i <= i_max; i++)
+		{
+			velTable[c][i] = (uint32_t)( ( vel_max + vel_max / (b * i_max) ) / (1.0 + b * i) - vel_max / (b * i_max) + 0.5 );
+		}
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Gen_Bender - 0 ... 8000 for the absolute bender amount
+*			curve 0: y = x, 1: y = 0.5 * x + 0.5 * x^3, 2: y = x^3
+******************************************************************************/
+
+static void Gen_Bender(void)
+{
+	static const float s_curve[NUM_HW_CURVES] = { 0.0, 0.5, 1.0 };		// s defines the curve shape
+
+	float range = 8000.0;
+	float s;
+	float x;
+
+	uint32_t i_max = HW_TABLE_SIZE - 1;
+	uint32_t c;
+	uint32_t i;
+
+	for (c = 0; c < NUM_HW_CURVES; c++)
+	{
+		s = s_curve[c];
+
+		for (i = 0; i <= i_max; i++)
+		{
+			x = (float)i / (float)i_max;
+
+			benderTable[c][i] = (uint32_t)( range * x * ((1.0 - s) + s * x*x ) );
+		}
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Gen_Aftertouch - 0 ... 16000 (full TCD range)
+*			curve 0: y = x, 1: y = 0.3 * x + 0.7 * x^6, 2: y = 0.05 * x + 0.95 * x^6
+******************************************************************************/
+
+static void Gen_Aftertouch(void)
+{
+	static const float s_curve[NUM_HW_CURVES] = { 0.0, 0.7, 0.95 };		// s defines the curve shape
+
+	float range = 16000.0;
+	float s;
+	float x;
+
+	uint32_t i_max = HW_TABLE_SIZE - 1;
+	uint32_t c;
+	uint32_t i;
+
+	for (c = 0; c < NUM_HW_CURVES; c++)
+	{
+		s = s_curve[c];
+
+		for (i = 0; i <= i_max; i++)
+		{
+			x = (float)i / (float)i_max;
+
+			atTable[c][i] = (uint32_t)( range * x * ((1.0 - s) + s * x*x*x*x*x ) );
+		}
+	}
+}
+
+
+static void Print_Table(const uint32_t* table, uint32_t size, const char* indent)
+{
+	uint32_t i;
+
+	for (i = 0; i < size; i++)
+	{
+		if ((i % 8) == 0)
+		{
+			printf("%s", indent);
+		}
+
+		printf("%u%s", table[i], (i < size - 1) ? "," : "");
+
+		if (((i % 8) == 7) || (i == size - 1))
+		{
+			printf("\n");
+		}
+		else
+		{
+			printf("\t");
+		}
+	}
+}
+
+
+static void Print_Curves(const char* name, const uint32_t* tables, uint32_t numCurves, uint32_t size)
+{
+	uint32_t c;
+
+	printf("const uint32_t %s[%u][%u] =\n{\n", name, numCurves, size);
+
+	for (c = 0; c < numCurves; c++)
+	{
+		printf("\t{\n");
+		Print_Table(tables + c * size, size, "\t\t");
+		printf("\t}%s\n", (c < numCurves - 1) ? "," : "");
+	}
+
+	printf("};\n\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+	uint32_t shift;
+
+	if ((argc > 1) && (strcmp(argv[1], "-r") == 0))
+	{
+		Report_Expon();
+		return 0;
+	}
+
+	Gen_Velocity();
+	Gen_Bender();
+	Gen_Aftertouch();
+
+	printf("/*\n");
+	printf(" * nl_tcd_tables.c\n");
+	printf(" *\n");
+	printf(" *  generated by tools/tcd_tables/gen_tcd_tables.c - do not edit\n");
+	printf(" */\n\n");
+	printf("#include \"nl_tcd_tables.h\"\n\n\n");
+
+	printf("const uint32_t EXPON_LIN_SLOPE = %u;\n\n", Gen_ExponLinSlope());
+
+	for (shift = EXPON_MIN_SHIFT; shift <= EXPON_MAX_SHIFT; shift++)
+	{
+		Gen_Expon(shift);
+
+		printf("#%s (EXPON_SEGMENT_SHIFT == %u)\n\n", (shift == EXPON_MIN_SHIFT) ? "if" : "elif", shift);
+		printf("const uint32_t EXPON_TABLE[%u] =\n{\n", (16000 >> shift) + 1);
+		Print_Table(expTime, (16000 >> shift) + 1, "\t");
+		printf("};\n\n");
+	}
+
+	printf("#else\n");
+	printf("#error \"EXPON_SEGMENT_SHIFT must be %u ... %u\"\n", EXPON_MIN_SHIFT, EXPON_MAX_SHIFT);
+	printf("#endif\n\n");
+
+	Print_Curves("VEL_TABLE", &velTable[0][0], NUM_VEL_CURVES, VEL_TABLE_SIZE);
+	Print_Curves("BENDER_TABLE", &benderTable[0][0], NUM_HW_CURVES, HW_TABLE_SIZE);
+	Print_Curves("AT_TABLE", &atTable[0][0], NUM_HW_CURVES, HW_TABLE_SIZE);
+
+	return 0;
+}
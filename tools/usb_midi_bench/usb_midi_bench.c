@@ -0,0 +1,414 @@
+/******************************************************************************/
+/** @file		usb_midi_bench.c
+    @brief    	host tool: USB-MIDI loopback and throughput test of the LPC
+    @author		KSTR
+
+    Needs an M4 firmware built with USB_MIDI_BENCHMARK (nl_usb_midi_bench.h
+    describes the SysEx protocol). The tool sends timestamped pings, which
+    the LPC echoes, and lets the LPC stream timestamped packets at the same
+    time. Once per second it prints the throughput in both directions, the
+    packet loss and the round-trip latency percentiles of the pings.
+
+    build and run (from the repository root):
+      gcc -O2 -o usb_midi_bench tools/usb_midi_bench/usb_midi_bench.c -lasound -lpthread
+      ./usb_midi_bench -d hw:1,0,0 -p 1000 -s 4 -l 64 -t 10
+
+      -d  ALSA rawmidi device of the LPC ("amidi -l")
+      -p  pings per second (0: no pings)
+      -q  length of a ping in bytes (12 ... 64)
+      -s  stream packets per ms from the LPC (0 ... 32, 0: off)
+      -l  length of a stream packet in bytes (12 ... 254, even)
+      -t  duration in seconds
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <alsa/asoundlib.h>
+
+#define BENCH_ID		0x7D		// same as in nl_usb_midi_bench.h
+#define BENCH_PING		0x01
+#define BENCH_ECHO		0x02
+#define BENCH_STREAM	0x03
+#define BENCH_CONFIG	0x10
+#define BENCH_REPORT	0x11
+
+#define SEQ_MASK		0x1FFFFF	// 21-bit sequence numbers
+#define MAX_SYSEX		256
+#define MAX_SAMPLES		1000000
+
+
+static snd_rawmidi_t* midiIn;
+static snd_rawmidi_t* midiOut;
+
+static volatile int running = 1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* statistics of the current second, protected by lock */
+static uint64_t pingsSent;
+static uint64_t echoes;
+static uint64_t echoBytes;
+static uint64_t streamPackets;
+static uint64_t streamBytes;
+static uint64_t streamLost;
+static uint32_t streamSeq;
+static int streamStarted;
+static uint32_t lastLpcTime;
+static uint32_t maxLpcGap;
+
+/* round-trip times of the whole run */
+static uint32_t* rtt;
+static uint32_t rttNum;
+static uint32_t rttSecondStart;
+
+
+static uint32_t Now_Us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+
+static void Put(uint8_t* p, uint32_t val, int groups)
+{
+	while (groups--)
+	{
+		*p++ = val & 0x7F;
+		val >>= 7;
+	}
+}
+
+
+static uint32_t Get(const uint8_t* p, int groups)
+{
+	uint32_t val = 0;
+	int i;
+
+	for (i = groups - 1; i >= 0; i--)
+	{
+		val = (val << 7) | (p[i] & 0x7F);
+	}
+	return val;
+}
+
+
+static int Cmp_U32(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*) a;
+	uint32_t y = *(const uint32_t*) b;
+	return (x > y) - (x < y);
+}
+
+
+/*****************************************************************************
+* @brief	Print_Percentiles - latency percentiles of the samples from..to-1
+******************************************************************************/
+
+static void Print_Percentiles(const char* title, uint32_t from, uint32_t to)
+{
+	uint32_t n = to - from;
+	uint32_t* s;
+
+	if (n == 0)
+	{
+		printf("%s: no echoes\n", title);
+		return;
+	}
+
+	s = malloc(n * sizeof(uint32_t));
+	memcpy(s, rtt + from, n * sizeof(uint32_t));
+	qsort(s, n, sizeof(uint32_t), Cmp_U32);
+
+	printf("%s: rtt [us] min %u  p50 %u  p90 %u  p99 %u  p99.9 %u  max %u  (%u echoes)\n",
+		   title, s[0], s[n / 2], s[(uint64_t) n * 90 / 100], s[(uint64_t) n * 99 / 100],
+		   s[(uint64_t) n * 999 / 1000], s[n - 1], n);
+
+	free(s);
+}
+
+
+static void Send_SysEx(const uint8_t* data, size_t len)
+{
+	if (snd_rawmidi_write(midiOut, data, len) < 0)
+	{
+		fprintf(stderr, "write error\n");
+		running = 0;
+	}
+}
+
+
+/*****************************************************************************
+* @brief	Handle_SysEx - evaluates a complete SysEx message of the LPC
+******************************************************************************/
+
+static void Handle_SysEx(const uint8_t* msg, uint32_t len, uint32_t now)
+{
+	uint32_t seq;
+	uint32_t t;
+
+	if ((len < 4) || (msg[1] != BENCH_ID))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	switch (msg[2])
+	{
+		case BENCH_ECHO:
+			if (len >= 12)
+			{
+				t = Get(msg + 6, 5);
+				echoes++;
+				echoBytes += len;
+				if (rttNum < MAX_SAMPLES)
+				{
+					rtt[rttNum++] = now - t;
+				}
+			}
+			break;
+
+		case BENCH_STREAM:
+			if (len >= 12)
+			{
+				seq = Get(msg + 3, 3);
+				t = Get(msg + 6, 5);
+				if (streamStarted)
+				{
+					streamLost += (seq - streamSeq) & SEQ_MASK;
+					if (t - lastLpcTime > maxLpcGap)
+					{
+						maxLpcGap = t - lastLpcTime;
+					}
+				}
+				streamStarted = 1;
+				streamSeq = (seq + 1) & SEQ_MASK;
+				lastLpcTime = t;
+				streamPackets++;
+				streamBytes += len;
+			}
+			break;
+
+		case BENCH_REPORT:
+			if (len >= 34)
+			{
+				printf("  LPC:  rx %u B/s (%u pkts, %u lost)   tx %u B/s (%u pkts, %u dropped)\n",
+					   Get(msg + 3, 5), Get(msg + 8, 5), Get(msg + 13, 5),
+					   Get(msg + 18, 5), Get(msg + 23, 5), Get(msg + 28, 5));
+			}
+			break;
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+
+/*****************************************************************************
+* @brief	Reader - collects the SysEx messages from the raw byte stream
+******************************************************************************/
+
+static void* Reader(void* arg)
+{
+	uint8_t buf[1024];
+	uint8_t msg[MAX_SYSEX];
+	uint32_t len = 0;
+	int inSysEx = 0;
+	ssize_t n;
+	ssize_t i;
+
+	while (running)
+	{
+		n = snd_rawmidi_read(midiIn, buf, sizeof(buf));
+		if (n == -EAGAIN)
+		{
+			usleep(50);
+			continue;
+		}
+		if (n < 0)
+		{
+			fprintf(stderr, "read error %s\n", snd_strerror(n));
+			running = 0;
+			break;
+		}
+
+		uint32_t now = Now_Us();
+
+		for (i = 0; i < n; i++)
+		{
+			if (buf[i] == 0xF0)
+			{
+				inSysEx = 1;
+				len = 0;
+			}
+			else if (buf[i] >= 0xF8)
+			{
+				continue;								// real time bytes may be interleaved
+			}
+			else if ((buf[i] & 0x80) && (buf[i] != 0xF7))
+			{
+				inSysEx = 0;							// any other status byte aborts the message
+				continue;
+			}
+
+			if (!inSysEx)
+			{
+				continue;
+			}
+
+			if (len < MAX_SYSEX)
+			{
+				msg[len++] = buf[i];
+			}
+
+			if (buf[i] == 0xF7)
+			{
+				Handle_SysEx(msg, len, now);
+				inSysEx = 0;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+static void Usage(const char* name)
+{
+	fprintf(stderr, "usage: %s -d <rawmidi device> [-p pings/s] [-q ping length] "
+			"[-s stream pkts/ms] [-l stream length] [-t seconds]\n", name);
+	exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* device = NULL;
+	int pingRate = 1000;
+	int pingLength = 12;
+	int streamRate = 0;
+	int streamLength = 64;
+	int duration = 10;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:p:q:s:l:t:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': device = optarg; break;
+			case 'p': pingRate = atoi(optarg); break;
+			case 'q': pingLength = atoi(optarg); break;
+			case 's': streamRate = atoi(optarg); break;
+			case 'l': streamLength = atoi(optarg); break;
+			case 't': duration = atoi(optarg); break;
+			default: Usage(argv[0]);
+		}
+	}
+
+	if ((device == NULL) || (pingLength < 12) || (pingLength > 64)
+		|| (streamRate < 0) || (streamRate > 32))
+	{
+		Usage(argv[0]);
+	}
+
+	if ((streamLength < 12) || (streamLength > 254) || (streamLength & 1))
+	{
+		fprintf(stderr, "-l: even length from 12 to 254 (sent as length/2 in one data byte)\n");
+		return 1;
+	}
+
+	if (snd_rawmidi_open(&midiIn, &midiOut, device, SND_RAWMIDI_NONBLOCK) < 0)
+	{
+		fprintf(stderr, "cannot open %s\n", device);
+		return 1;
+	}
+	snd_rawmidi_nonblock(midiOut, 0);
+
+	rtt = malloc(MAX_SAMPLES * sizeof(uint32_t));
+
+	/* stream config, also resets the counters of the LPC */
+	uint8_t config[6] = { 0xF0, BENCH_ID, BENCH_CONFIG, (uint8_t) streamRate, (uint8_t) (streamLength / 2), 0xF7 };
+	Send_SysEx(config, sizeof(config));
+
+	pthread_t reader;
+	pthread_create(&reader, NULL, Reader, NULL);
+
+	uint8_t ping[64];
+	uint32_t seq = 0;
+	uint32_t start = Now_Us();
+	uint32_t nextPing = start;
+	uint32_t nextReport = start + 1000000;
+	int i;
+
+	ping[0] = 0xF0;
+	ping[1] = BENCH_ID;
+	ping[2] = BENCH_PING;
+	for (i = 11; i < pingLength - 1; i++)
+	{
+		ping[i] = i & 0x7F;
+	}
+	ping[pingLength - 1] = 0xF7;
+
+	while (running && ((int32_t) (Now_Us() - start) < duration * 1000000))
+	{
+		uint32_t now = Now_Us();
+
+		if (pingRate && ((int32_t) (now - nextPing) >= 0))
+		{
+			Put(ping + 3, seq, 3);
+			Put(ping + 6, now, 5);
+			seq = (seq + 1) & SEQ_MASK;
+			Send_SysEx(ping, pingLength);
+			snd_rawmidi_drain(midiOut);
+
+			pthread_mutex_lock(&lock);
+			pingsSent++;
+			pthread_mutex_unlock(&lock);
+
+			nextPing += 1000000 / pingRate;
+		}
+
+		if ((int32_t) (now - nextReport) >= 0)
+		{
+			pthread_mutex_lock(&lock);
+			printf("host: tx %llu B/s (%llu pings)   rx echo %llu B/s (%llu)   rx stream %llu B/s (%llu pkts, %llu lost, max gap %u us)\n",
+				   (unsigned long long) (pingsSent * pingLength), (unsigned long long) pingsSent,
+				   (unsigned long long) echoBytes, (unsigned long long) echoes,
+				   (unsigned long long) streamBytes, (unsigned long long) streamPackets,
+				   (unsigned long long) streamLost, maxLpcGap);
+			Print_Percentiles("      ", rttSecondStart, rttNum);
+			rttSecondStart = rttNum;
+			pingsSent = echoes = echoBytes = 0;
+			streamPackets = streamBytes = streamLost = 0;
+			maxLpcGap = 0;
+			pthread_mutex_unlock(&lock);
+
+			nextReport += 1000000;
+		}
+
+		usleep(20);
+	}
+
+	/* stop the stream */
+	config[3] = 0;
+	Send_SysEx(config, sizeof(config));
+	snd_rawmidi_drain(midiOut);
+
+	running = 0;
+	pthread_join(reader, NULL);
+
+	printf("\n");
+	pthread_mutex_lock(&lock);
+	Print_Percentiles("total", 0, rttNum);
+	pthread_mutex_unlock(&lock);
+
+	snd_rawmidi_close(midiIn);
+	snd_rawmidi_close(midiOut);
+	free(rtt);
+
+	return 0;
+}